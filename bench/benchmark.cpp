@@ -0,0 +1,120 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <arrrgh.hpp>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+struct RegisteredBenchmark {
+    std::string name;
+    BenchmarkSetup setup;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    size_t iterations;
+    double medianNs;
+    double minNs;
+    double maxNs;
+};
+
+// Function local, as the benchmarks are registered during static initialisation
+static std::vector<RegisteredBenchmark> &registeredBenchmarks() {
+    static std::vector<RegisteredBenchmark> benchmarks;
+    return benchmarks;
+}
+
+void registerBenchmark(const std::string &name, BenchmarkSetup setup) {
+    registeredBenchmarks().push_back({name, std::move(setup)});
+}
+
+static double timeBatch(const BenchmarkBody &body, size_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    body(iterations);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static BenchmarkResult runBenchmark(const RegisteredBenchmark &benchmark) {
+    BenchmarkBody body = benchmark.setup();
+
+    // The first batch also warms up caches and allocators
+    size_t iterations = 1;
+    double seconds = timeBatch(body, iterations);
+    while (seconds < BENCHMARK_MIN_BATCH_SECONDS) {
+        double growth = seconds > 0 ? BENCHMARK_MIN_BATCH_SECONDS * 1.2 / seconds : 10;
+        iterations = size_t(iterations * std::min(std::max(growth, 1.5), 10.0));
+        seconds = timeBatch(body, iterations);
+    }
+
+    std::vector<double> samples;
+    for (int i = 0; i < BENCHMARK_SAMPLES; i++) {
+        samples.push_back(timeBatch(body, iterations) * 1e9 / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchmarkResult result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.medianNs = samples[samples.size() / 2];
+    result.minNs = samples.front();
+    result.maxNs = samples.back();
+    return result;
+}
+
+static void writeResults(FILE *file, const std::vector<BenchmarkResult> &results) {
+    fprintf(file, "{\n  \"context\": {\"threads\": %u, \"samples\": %d},\n  \"benchmarks\": [",
+            std::thread::hardware_concurrency(), BENCHMARK_SAMPLES);
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult &result = results[i];
+        fprintf(file,
+                "%s\n    {\"name\": \"%s\", \"iterations\": %zu, \"median_ns\": %.1f, \"min_ns\": %.1f, "
+                "\"max_ns\": %.1f}",
+                i == 0 ? "" : ",", result.name.c_str(), result.iterations, result.medianNs, result.minNs,
+                result.maxNs);
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+int main(int argc, const char *argv[]) {
+    arrrgh::parser parser("glowbox_bench", "Microbenchmarks of glowbox's CPU code, reported as JSON");
+    const auto &showHelp = parser.add<bool>("help", "Show this help message.", 'h', arrrgh::Optional, false);
+    const auto &filter = parser.add<std::string>("filter", "Only run benchmarks whose name contains this.", 'f',
+                                                 arrrgh::Optional, "");
+    const auto &outFile = parser.add<std::string>("out", "Write the JSON to this file instead of stdout.", 'o',
+                                                  arrrgh::Optional, "");
+
+    try {
+        parser.parse(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << "Error parsing arguments: " << e.what() << std::endl;
+        parser.show_usage(std::cerr);
+        return 1;
+    }
+    if (showHelp.value()) {
+        return 0;
+    }
+
+    std::vector<BenchmarkResult> results;
+    for (const RegisteredBenchmark &benchmark : registeredBenchmarks()) {
+        if (benchmark.name.find(filter.value()) == std::string::npos) {
+            continue;
+        }
+        BenchmarkResult result = runBenchmark(benchmark);
+        // Progress goes to stderr, so stdout is only the JSON
+        fprintf(stderr, "%-48s %14.1f ns\n", result.name.c_str(), result.medianNs);
+        results.push_back(result);
+    }
+
+    FILE *file = outFile.value().empty() ? stdout : fopen(outFile.value().c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "Could not write %s\n", outFile.value().c_str());
+        return 1;
+    }
+    writeResults(file, results);
+    if (file != stdout) {
+        fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// Batches are grown until one takes at least this long, to keep the clock's resolution
+// out of the measurement
+#define BENCHMARK_MIN_BATCH_SECONDS 0.01
+// Batches timed per benchmark once the batch size is known
+#define BENCHMARK_SAMPLES 10
+
+// Runs the code being measured the given number of times
+using BenchmarkBody = std::function<void(size_t iterations)>;
+// Prepares the inputs of a benchmark and returns its body. Only called for the benchmarks
+// that are run, so expensive inputs are not built for the ones that are filtered out.
+using BenchmarkSetup = std::function<BenchmarkBody()>;
+
+void registerBenchmark(const std::string &name, BenchmarkSetup setup);
+
+// Registers benchmarks from a file's static initialisers:
+//     BENCHMARKS { registerBenchmark("name", [] { return [](size_t iterations) { ... }; }); }
+#define BENCHMARK_CONCATENATE_(a, b) a##b
+#define BENCHMARK_CONCATENATE(a, b) BENCHMARK_CONCATENATE_(a, b)
+#define BENCHMARKS                                                                                                     \
+    static void BENCHMARK_CONCATENATE(registerBenchmarks, __LINE__)();                                                 \
+    static const bool BENCHMARK_CONCATENATE(benchmarksRegistered, __LINE__) =                                          \
+        (BENCHMARK_CONCATENATE(registerBenchmarks, __LINE__)(), true);                                                 \
+    static void BENCHMARK_CONCATENATE(registerBenchmarks, __LINE__)()
+
+// Keeps the compiler from optimising away a result that is otherwise unused
+template <class T> inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
@@ -0,0 +1,72 @@
+#include "benchmark.h"
+#include <memory>
+#include <perfHud.hpp>
+
+// Stats with every field set, so that every line of the overlay has numbers to format
+static FrameStats sampleStats(double frameMs) {
+    FrameStats stats;
+    stats.frameMs = frameMs;
+    stats.updateFrameMs = 0.8;
+    stats.transformMs = 0.3;
+    stats.renderFrameMs = 1.7;
+    stats.gpuMs = 2.4;
+    stats.inputLatencyMs = 4.2;
+    stats.inputLatencySamples = 1;
+    stats.drawCalls = 412;
+    stats.triangles = 1830000;
+    stats.visibleNodes = 389;
+    stats.residentChunks = 24;
+    stats.streamingMegabytes = 96.5;
+    stats.uploadMs = 0.6;
+    stats.lodFinestTriangles = 3200000;
+    stats.lodSelectedTriangles = 1100000;
+    stats.occludedNodes = 57;
+    stats.occlusionMs = 0.12;
+    stats.glCallsIssued = 930;
+    stats.glCallsSkipped = 410;
+    return stats;
+}
+
+// The overlay's CPU work each frame while it is shown. Its text lines are drawn along
+// with all other text, and are not part of this.
+struct ShownPerfHud {
+    ShownPerfHud() : root(createSceneNode()), hud(root) {
+        hud.toggle();
+        overlay.reserve(PERF_HUD_GRAPH_FRAMES + 1);
+    }
+    ~ShownPerfHud() { destroySceneNode(root); }
+
+    SceneNode *root;
+    PerfHud hud;
+    std::vector<GlyphInstance> overlay;
+};
+
+BENCHMARKS {
+    // At 1 ms frames the text is only formatted every PERF_HUD_REFRESH_INTERVAL
+    registerBenchmark("PerfHud/frame", [] {
+        auto shown = std::make_shared<ShownPerfHud>();
+        return [shown](size_t iterations) {
+            FrameStats stats = sampleStats(1.0);
+            for (size_t i = 0; i < iterations; i++) {
+                shown->hud.update(stats);
+                shown->overlay.clear();
+                shown->hud.drawGraph(shown->overlay);
+                doNotOptimize(shown->overlay.data());
+            }
+        };
+    });
+
+    // Frames longer than the refresh interval format every line every frame
+    registerBenchmark("PerfHud/frame with refresh", [] {
+        auto shown = std::make_shared<ShownPerfHud>();
+        return [shown](size_t iterations) {
+            FrameStats stats = sampleStats(1000.0 * PERF_HUD_REFRESH_INTERVAL);
+            for (size_t i = 0; i < iterations; i++) {
+                shown->hud.update(stats);
+                shown->overlay.clear();
+                shown->hud.drawGraph(shown->overlay);
+                doNotOptimize(shown->overlay.data());
+            }
+        };
+    });
+}
@@ -0,0 +1,74 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <fmt/format.h>
+#include <random>
+#include <utilities/imageLoader.hpp>
+#include <utilities/imageWriter.h>
+
+// Something like a captured frame: a shaded background, a few flat shapes, and a
+// textured wall whose texels vary a little from their neighbours
+static std::vector<unsigned char> syntheticFrame(unsigned int width, unsigned int height) {
+    std::vector<unsigned char> pixels(size_t(width) * height * 4);
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> noise(-6, 6);
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < width; x++) {
+            unsigned char *pixel = &pixels[(size_t(y) * width + x) * 4];
+            int shade = 40 + 120 * y / height;
+            if (x > width / 8 && x < width * 7 / 8 && y > height / 3) {
+                int texel = shade + 40 + noise(random);
+                pixel[0] = (unsigned char)std::min(255, texel + 30);
+                pixel[1] = (unsigned char)std::min(255, texel);
+                pixel[2] = (unsigned char)std::min(255, texel / 2);
+            } else if ((x / 64 + y / 64) % 7 == 0) {
+                pixel[0] = 230;
+                pixel[1] = 230;
+                pixel[2] = 255;
+            } else {
+                pixel[0] = (unsigned char)(shade / 3);
+                pixel[1] = (unsigned char)(shade / 2);
+                pixel[2] = (unsigned char)shade;
+            }
+            pixel[3] = 255;
+        }
+    }
+    return pixels;
+}
+
+BENCHMARKS {
+    for (const char *name : {"charmap.png", "Brick03_col.png"}) {
+        registerBenchmark(fmt::format("loadPNGFile/{}", name), [name] {
+            std::string fileName = fmt::format("{}/res/textures/{}", PROJECT_SOURCE_DIR, name);
+            return [fileName](size_t iterations) {
+                for (size_t i = 0; i < iterations; i++) {
+                    doNotOptimize(loadPNGFile(fileName));
+                }
+            };
+        });
+    }
+
+    // What each capture encoder thread does per frame at the default capture size
+    registerBenchmark("encodeQOI/1920x1080", [] {
+        std::vector<unsigned char> frame = syntheticFrame(1920, 1080);
+        return [frame](size_t iterations) {
+            for (size_t i = 0; i < iterations; i++) {
+                doNotOptimize(encodeQOI(frame.data(), 1920, 1080));
+            }
+        };
+    });
+
+    for (unsigned int size : {256, 1024, 4096}) {
+        registerBenchmark(fmt::format("flipVertically/{}x{}", size, size), [size] {
+            PNGImage image;
+            image.width = size;
+            image.height = size;
+            image.pixels.assign(size_t(size) * size * 4, 0x7f);
+            return [image](size_t iterations) mutable {
+                for (size_t i = 0; i < iterations; i++) {
+                    flipVertically(image);
+                    doNotOptimize(image.pixels.data());
+                }
+            };
+        });
+    }
+}
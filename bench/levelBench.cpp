@@ -0,0 +1,19 @@
+#include "benchmark.h"
+#include <fmt/format.h>
+#include <utilities/glutils.h>
+#include <utilities/objLoader.h>
+
+BENCHMARKS {
+    // What the level loader thread does for each chunk of the sample level, before the
+    // render thread uploads it
+    registerBenchmark("loadLevelChunk/sample", [] {
+        std::string fileName = fmt::format("{}/res/levels/sample/chunk_0_0.obj", PROJECT_SOURCE_DIR);
+        return [fileName](size_t iterations) {
+            for (size_t i = 0; i < iterations; i++) {
+                for (OBJObject &object : loadOBJFile(fileName)) {
+                    doNotOptimize(bakeMesh(object.mesh));
+                }
+            }
+        };
+    });
+}
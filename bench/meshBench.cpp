@@ -0,0 +1,31 @@
+#include "benchmark.h"
+#include <fmt/format.h>
+#include <utilities/glutils.h>
+#include <utilities/shapes.h>
+#include <utilities/tangents.h>
+
+BENCHMARKS {
+    // The tangents and packing that generateBuffer does before uploading
+    for (int tessellation : {40, 320}) {
+        registerBenchmark(fmt::format("generateTangents/sphere {}x{}", tessellation, tessellation), [tessellation] {
+            Mesh sphere = generateIndexedSphere(1.0, tessellation, tessellation);
+            return [sphere](size_t iterations) mutable {
+                for (size_t i = 0; i < iterations; i++) {
+                    generateTangents(sphere);
+                    doNotOptimize(sphere.tangents.data());
+                }
+            };
+        });
+
+        registerBenchmark(fmt::format("bakeMesh/sphere {}x{}", tessellation, tessellation), [tessellation] {
+            Mesh sphere = generateIndexedSphere(1.0, tessellation, tessellation);
+            return [sphere](size_t iterations) {
+                for (size_t i = 0; i < iterations; i++) {
+                    // bakeMesh optimizes the mesh in place, so every iteration starts from a copy
+                    Mesh mesh = sphere;
+                    doNotOptimize(bakeMesh(mesh));
+                }
+            };
+        });
+    }
+}
@@ -0,0 +1,68 @@
+#include "benchmark.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <random>
+#include <utilities/occlusionCuller.h>
+#include <utilities/shapes.h>
+
+// The game's view into the box, with spheres spread through the box and the level around it
+struct OcclusionScene {
+    explicit OcclusionScene(size_t sphereCount) {
+        const glm::vec3 boxDimensions(180, 90, 90);
+        box = makeOccluder(cube(boxDimensions, glm::vec2(90), true, true));
+
+        glm::mat4 projection = glm::perspective(glm::radians(80.0f), 1366.0f / 768.0f, 0.1f, 350.f);
+        glm::mat4 view = glm::rotate(glm::mat4(1), 0.25f, glm::vec3(1, 0, 0)) *
+                         glm::translate(glm::mat4(1), -glm::vec3(0, 2, -20));
+        viewProjection = projection * view;
+        boxMVP = viewProjection * glm::translate(glm::mat4(1), glm::vec3(0, -10, -80));
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> distribution(-300, 300);
+        for (size_t i = 0; i < sphereCount; i++) {
+            glm::vec3 position(distribution(random), distribution(random) / 10, distribution(random) - 80);
+            sphereMVPs.push_back(viewProjection * glm::translate(glm::mat4(1), position));
+        }
+    }
+
+    void rasterize() {
+        culler.beginFrame();
+        culler.addOccluder(box, boxMVP);
+        culler.endFrame();
+    }
+
+    OcclusionCuller culler;
+    OccluderMesh box;
+    glm::mat4 viewProjection;
+    glm::mat4 boxMVP;
+    std::vector<glm::mat4> sphereMVPs;
+};
+
+BENCHMARKS {
+    registerBenchmark("OcclusionCuller/rasterize box", [] {
+        std::shared_ptr<OcclusionScene> scene = std::make_shared<OcclusionScene>(0);
+        return [scene](size_t iterations) {
+            for (size_t i = 0; i < iterations; i++) {
+                scene->rasterize();
+            }
+        };
+    });
+
+    // Also reports how many of the spheres are culled
+    registerBenchmark("OcclusionCuller/isOccluded 10000", [] {
+        std::shared_ptr<OcclusionScene> scene = std::make_shared<OcclusionScene>(10000);
+        scene->rasterize();
+        size_t occluded = 0;
+        for (const glm::mat4 &mvp : scene->sphereMVPs) {
+            occluded += scene->culler.isOccluded(mvp, glm::vec3(2)) ? 1 : 0;
+        }
+        fprintf(stderr, "OcclusionCuller: %zu of %zu spheres occluded\n", occluded, scene->sphereMVPs.size());
+        return [scene](size_t iterations) {
+            for (size_t i = 0; i < iterations; i++) {
+                for (const glm::mat4 &mvp : scene->sphereMVPs) {
+                    doNotOptimize(scene->culler.isOccluded(mvp, glm::vec3(2)));
+                }
+            }
+        };
+    });
+}
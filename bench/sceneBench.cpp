@@ -0,0 +1,143 @@
+#include "benchmark.h"
+#include <fmt/format.h>
+#include <keyFrames.hpp>
+#include <memory>
+#include <random>
+#include <sceneGraph.hpp>
+#include <utilities/shapes.h>
+
+// Every node has up to eight children, with random transforms
+struct SyntheticSceneGraph {
+    explicit SyntheticSceneGraph(size_t nodeCount) {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> distribution(-1, 1);
+        nodes.reserve(nodeCount);
+        for (size_t i = 0; i < nodeCount; i++) {
+            SceneNode *node = createSceneNode();
+            node->position = glm::vec3(distribution(random), distribution(random), distribution(random)) * 10.0f;
+            node->rotation = glm::vec3(distribution(random), distribution(random), distribution(random));
+            if (i > 0) {
+                addChild(nodes[(i - 1) / 8], node);
+            }
+            nodes.push_back(node);
+        }
+    }
+
+    ~SyntheticSceneGraph() { destroySceneNode(nodes[0]); }
+
+    std::vector<SceneNode *> nodes;
+};
+
+// Spheres of radius 1 to 5 spread over a square around the camera, each with the level
+// chain of the ball. The VAOs are never drawn, so they are left at 0.
+struct SyntheticLODScene {
+    SyntheticLODScene(size_t sphereCount, float extent) {
+        std::vector<MeshLOD> lods;
+        std::vector<Mesh> meshes = generateSphereLODs(1.0, 40, 40, 4);
+        for (size_t level = 0; level < meshes.size(); level++) {
+            int tessellation = 40 >> level;
+            lods.push_back({0, unsigned(meshes[level].indices.size()), GL_UNSIGNED_SHORT,
+                            sphereTessellationError(1.0, tessellation, tessellation)});
+        }
+
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> position(-extent / 2, extent / 2);
+        std::uniform_real_distribution<float> radius(1, 5);
+        root = createSceneNode();
+        for (size_t i = 0; i < sphereCount; i++) {
+            SceneNode *node = createSceneNode();
+            node->position = glm::vec3(position(random), 0, position(random));
+            node->scale = glm::vec3(radius(random));
+            node->lods = lods;
+            node->boundingRadius = 1;
+            addChild(root, node);
+        }
+        updateNodeTransformations(root, glm::mat4(1), glm::mat4(1));
+
+        // The game's camera: 1366x768 with an 80 degree field of view
+        selection.cameraPosition = glm::vec3(0);
+        selection.pixelsPerUnit = 768 / (2 * tan(glm::radians(80.0f) / 2));
+        selection.maxPixelError = 0.5f;
+    }
+
+    ~SyntheticLODScene() { destroySceneNode(root); }
+
+    SceneNode *root;
+    LODSelection selection;
+};
+
+BENCHMARKS {
+    for (size_t nodeCount : {10, 1000, 100000, 1000000}) {
+        registerBenchmark(fmt::format("updateNodeTransformations/{}", nodeCount), [nodeCount] {
+            std::shared_ptr<SyntheticSceneGraph> graph = std::make_shared<SyntheticSceneGraph>(nodeCount);
+            return [graph](size_t iterations) {
+                for (size_t i = 0; i < iterations; i++) {
+                    updateNodeTransformations(graph->nodes[0], glm::mat4(1), glm::mat4(1));
+                    doNotOptimize(graph->nodes.back()->currentMVPMatrix);
+                }
+            };
+        });
+    }
+
+    // Reports how many triangles the selection saves, as well as timing it
+    for (size_t sphereCount : {1000, 100000}) {
+        registerBenchmark(fmt::format("selectLODs/{}", sphereCount), [sphereCount] {
+            std::shared_ptr<SyntheticLODScene> scene = std::make_shared<SyntheticLODScene>(sphereCount, 700.0f);
+            LODStats stats;
+            selectLODs(scene->root, scene->selection, stats);
+            fprintf(stderr, "selectLODs/%zu: %u of %u triangles\n", sphereCount, stats.selectedTriangles,
+                    stats.finestTriangles);
+            return [scene](size_t iterations) {
+                for (size_t i = 0; i < iterations; i++) {
+                    LODStats stats;
+                    selectLODs(scene->root, scene->selection, stats);
+                    doNotOptimize(stats);
+                }
+            };
+        });
+    }
+
+    // Allocation is only measured once the pool has grown, as it is in a running game
+    registerBenchmark("createSceneNode+destroySceneNode/1000", [] {
+        return [](size_t iterations) {
+            for (size_t i = 0; i < iterations; i++) {
+                SceneNode *root = createSceneNode();
+                for (int child = 0; child < 999; child++) {
+                    addChild(root, createSceneNode());
+                }
+                destroySceneNode(root);
+            }
+        };
+    });
+
+    // Evicting the chunks of a large level one at a time, the last attached first
+    registerBenchmark("destroySceneNode/each of 10000 children", [] {
+        return [](size_t iterations) {
+            std::vector<SceneNode *> children(10000);
+            for (size_t i = 0; i < iterations; i++) {
+                SceneNode *root = createSceneNode();
+                for (SceneNode *&child : children) {
+                    child = createSceneNode();
+                    addChild(root, child);
+                }
+                for (auto child = children.rbegin(); child != children.rend(); ++child) {
+                    destroySceneNode(*child);
+                }
+                destroySceneNode(root);
+            }
+        };
+    });
+
+    // The search from updateFrame, once from the first key frame and once from halfway through the song
+    for (bool halfway : {false, true}) {
+        registerBenchmark(fmt::format("findKeyFrame/{}", halfway ? "halfway" : "start"), [halfway] {
+            unsigned int start = halfway ? unsigned(keyFrameTimeStamps.size() / 2) : 0;
+            double time = keyFrameTimeStamps[start] + 0.01;
+            return [start, time](size_t iterations) {
+                for (size_t i = 0; i < iterations; i++) {
+                    doNotOptimize(findKeyFrame(keyFrameTimeStamps, start, time));
+                }
+            };
+        });
+    }
+}
@@ -0,0 +1,35 @@
+#include "benchmark.h"
+#include <fmt/format.h>
+#include <utilities/glfont.h>
+#include <utilities/shapes.h>
+
+BENCHMARKS {
+    registerBenchmark("cube", [] {
+        return [](size_t iterations) {
+            for (size_t i = 0; i < iterations; i++) {
+                doNotOptimize(cube(glm::vec3(30, 3, 40), glm::vec2(30, 40), true));
+            }
+        };
+    });
+
+    for (int tessellation : {8, 40, 160, 640}) {
+        registerBenchmark(fmt::format("generateSphere/{}x{}", tessellation, tessellation), [tessellation] {
+            return [tessellation](size_t iterations) {
+                for (size_t i = 0; i < iterations; i++) {
+                    doNotOptimize(generateSphere(1.0, tessellation, tessellation));
+                }
+            };
+        });
+    }
+
+    for (size_t length : {16, 1024}) {
+        registerBenchmark(fmt::format("generateTextGeometryBuffer/{}", length), [length] {
+            std::string text(length, 'x');
+            return [text](size_t iterations) {
+                for (size_t i = 0; i < iterations; i++) {
+                    doNotOptimize(generateTextGeometryBuffer(text, 39.0f / 29.0f, 29.0f * text.size()));
+                }
+            };
+        });
+    }
+}
@@ -16,13 +16,28 @@ in layout(location = 3) mat3 tbn;
 uniform layout(location = 6) vec3 cameraPos;
 uniform layout(location = 7) vec3 ballPos;
 uniform layout(location = 8) uint features;
+// Texture array and layer of the diffuse texture (xy) and normal map (zw)
+uniform layout(location = 9) uvec4 textureLayers;
+// Offset (xy) and scale (zw) of the diffuse texture and normal map within their layers
+uniform layout(location = 10) vec4 diffuseRect;
+uniform layout(location = 11) vec4 normalRect;
 uniform Light lights[NUM_LIGHTS];
 
-layout(binding = 0) uniform sampler2D diffuseSampler;
-layout(binding = 1) uniform sampler2D normalSampler;
+// Must match MAX_TEXTURE_ARRAYS in textures.hpp
+layout(binding = 0) uniform sampler2DArray textureArrays[4];
 
 out vec4 color;
 
+vec4 sampleDiffuse() {
+    vec2 uv = diffuseRect.xy + textureCoordinates * diffuseRect.zw;
+    return texture(textureArrays[textureLayers.x], vec3(uv, textureLayers.y));
+}
+
+vec4 sampleNormal() {
+    vec2 uv = normalRect.xy + textureCoordinates * normalRect.zw;
+    return texture(textureArrays[textureLayers.z], vec3(uv, textureLayers.w));
+}
+
 float rand(vec2 co) { return fract(sin(dot(co.xy, vec2(12.9898,78.233))) * 43758.5453); }
 float dither(vec2 uv) { return (rand(uv)*2.0-1.0) / 256.0; }
 
@@ -45,13 +60,13 @@ void main()
     vec3 norm = normalize(normal);
 
     if (IS_ENABLED(DiffuseMap)) {
-        objectColor = texture(diffuseSampler, textureCoordinates);
+        objectColor = sampleDiffuse();
     } else if (IS_ENABLED(PhongLighting)) {
         objectColor = vec4(1.0);
     }
 
     if (IS_ENABLED(NormalMap)) {
-        norm = tbn * (texture(normalSampler, textureCoordinates).xyz * 2 - 1);
+        norm = tbn * (sampleNormal().xyz * 2 - 1);
     }
     
     if (IS_ENABLED(PhongLighting)) {
@@ -86,7 +101,7 @@ void main()
 
         color = vec4(ambient + diffuse + specular + dither(textureCoordinates), 1.0) * objectColor;
     } else if (IS_ENABLED(Text)) {
-        color = texture(diffuseSampler, textureCoordinates);
+        color = sampleDiffuse();
     } else {
         color = objectColor;
     }
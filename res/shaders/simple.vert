@@ -1,10 +1,12 @@
 #version 430 core
 
+// See PackedVertex in vertexFormat.h. The normal and tangent arrive as normalized
+// 10 bit integers and the texture coordinates as half floats.
 in layout(location = 0) vec3 position;
 in layout(location = 1) vec3 normal_in;
 in layout(location = 2) vec2 textureCoordinates_in;
-in layout(location = 3) vec3 tangent_in;
-in layout(location = 4) vec3 bitangent_in;
+// The sign of the bitangent is stored in w
+in layout(location = 3) vec4 tangent_in;
 
 uniform layout(location = 3) mat4 MVP;
 uniform layout(location = 4) mat4 model;
@@ -27,8 +29,9 @@ void main()
     position_out = vec3(model * vec4(position, 1.0));
 
     // Calculate the TBN matrix
-    vec3 t = normalize(vec3(model * vec4(tangent_in, 0.0)));
-    vec3 b = normalize(vec3(model * vec4(bitangent_in, 0.0)));
+    vec3 bitangent = cross(normal_in, tangent_in.xyz) * tangent_in.w;
+    vec3 t = normalize(vec3(model * vec4(tangent_in.xyz, 0.0)));
+    vec3 b = normalize(vec3(model * vec4(bitangent, 0.0)));
     vec3 n = normalize(vec3(model * vec4(normal_in, 0.0)));
     tbn_out = mat3(t, b, n);
 }
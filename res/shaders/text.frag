@@ -0,0 +1,23 @@
+#version 430 core
+
+in layout(location = 0) vec2 textureCoordinates;
+in layout(location = 1) vec4 color_in;
+in layout(location = 2) flat uint glyph;
+
+// Unit of the texture array holding the charmap, and its layer
+uniform layout(location = 2) sampler2DArray charmap;
+uniform layout(location = 3) uint charmapLayer;
+
+out vec4 color;
+
+// Must match SOLID_GLYPH in textRenderer.hpp
+const uint SolidGlyph = 0xFFFFFFFFu;
+
+void main()
+{
+    if (glyph == SolidGlyph) {
+        color = color_in;
+    } else {
+        color = texture(charmap, vec3(textureCoordinates, charmapLayer)) * color_in;
+    }
+}
@@ -0,0 +1,31 @@
+#version 430 core
+
+// One instance per glyph, see GlyphInstance in textRenderer.hpp
+in layout(location = 0) vec2 position;
+in layout(location = 1) vec2 size;
+in layout(location = 2) uint glyph;
+in layout(location = 3) vec4 color_in;
+
+uniform layout(location = 0) mat4 projection;
+// Offset (xy) and scale (zw) of the charmap within its texture array layer
+uniform layout(location = 1) vec4 charmapRect;
+
+out layout(location = 0) vec2 textureCoordinates_out;
+out layout(location = 1) vec4 color_out;
+out layout(location = 2) flat uint glyph_out;
+
+// Number of characters in the charmap, laid out side by side
+const float charmapGlyphs = 128.0;
+
+void main()
+{
+    // The quad is drawn as a triangle strip of four vertices
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+
+    vec2 glyphUV = vec2((float(glyph) + corner.x) / charmapGlyphs, corner.y);
+    textureCoordinates_out = charmapRect.xy + glyphUV * charmapRect.zw;
+    color_out = color_in;
+    glyph_out = glyph;
+
+    gl_Position = projection * vec4(position + corner * size, 0.0, 1.0);
+}
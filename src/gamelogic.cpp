@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 #include <SFML/Audio/Sound.hpp>
 #include <SFML/Audio/SoundBuffer.hpp>
+#include <algorithm>
 #include <chrono>
 #include <fmt/format.h>
 #include <glad/glad.h>
@@ -10,23 +11,32 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/vec3.hpp>
 #include <iostream>
+#include <mutex>
+#include <utilities/collision.h>
+#include <utilities/geometryCache.h>
+#include <utilities/glStateCache.h>
 #include <utilities/glutils.h>
+#include <utilities/gpuProfiler.h>
+#include <utilities/inputQueue.h>
+#include <utilities/inputRecording.h>
 #include <utilities/mesh.h>
+#include <utilities/occlusionCuller.h>
+#include <utilities/parallel.h>
+#include <utilities/profiler.h>
 #include <utilities/shader.hpp>
+#include <utilities/shaderReloader.h>
 #include <utilities/shapes.h>
 #include <utilities/timeutils.h>
 #define GLM_ENABLE_EXPERIMENTAL
+#include "perfHud.hpp"
+#include "textRenderer.hpp"
 #include "textures.hpp"
 #include "utilities/glfont.h"
 #include "utilities/imageLoader.hpp"
 #include <glm/gtx/transform.hpp>
 
-enum KeyFrameAction { BOTTOM, TOP };
-
-#include <timestamps.h>
-
-#define TEXT_CHAR_WIDTH 29.0f
-#define TEXT_CHAR_HEIGHT 39.0f
+#include "keyFrames.hpp"
+#include "levelStreamer.hpp"
 
 // Shader feature flags
 enum class ShaderFlags : GLuint {
@@ -46,7 +56,6 @@ double padPositionX = 0;
 double padPositionZ = 0;
 
 unsigned int currentKeyFrame = 0;
-unsigned int previousKeyFrame = 0;
 
 SceneNode *rootNode;
 SceneNode *boxNode;
@@ -54,8 +63,9 @@ SceneNode *ballNode;
 SceneNode *padNode;
 // Node for the light
 SceneNode *lightNode;
-// Node for text
+// Nodes for text
 SceneNode *textNode;
+SceneNode *timerNode;
 
 double ballRadius = 3.0f;
 
@@ -64,10 +74,65 @@ double ballRadius = 3.0f;
 sf::SoundBuffer *buffer;
 Gloom::Shader *shader;
 sf::Sound *sound;
+TextureAtlas *textureAtlas;
+TextRenderer *textRenderer;
+PerfHud *perfHud;
+GPUProfiler *gpuProfiler;
+ShaderReloader *shaderReloader;
+GLStateCache *glState;
+// Only created when a level is given with --level
+LevelStreamer *levelStreamer = nullptr;
+OcclusionCuller *occlusionCuller;
+// The walls of the box hide everything outside it
+OccluderMesh boxOccluder;
+
+// Looked up whenever the scene shader is linked, so that recording commands needs no GL
+// calls. The shader reloader relinks it on the render thread while updateFrame may be
+// recording on another, so it is only accessed under sceneProgramMutex.
+struct SceneProgram {
+    GLuint program;
+    GLint lightPositionLocation;
+    GLint lightColorLocation;
+};
+SceneProgram sceneProgram;
+std::mutex sceneProgramMutex;
+// The buffers merged into RenderSnapshot::commands, kept to avoid allocating every frame
+std::vector<const CommandBuffer *> sceneCommandBuffers;
+// The children of the root node, which are recorded in parallel
+std::vector<const SceneNode *> sceneSubtrees;
+// The commands that open and close the GPU zone of each draw group
+CommandBuffer drawGroupZoneBegins[DRAW_GROUPS];
+CommandBuffer drawGroupZoneEnds[DRAW_GROUPS];
+// The draws of the nodes that follow the pad, by draw group, merged into
+// RenderSnapshot::latchedCommands
+CommandBuffer latchedGroups[DRAW_GROUPS];
+
+// Measurements of the current frame, shown by the perf HUD. renderFrame may run on
+// another thread than updateFrame, so it measures into renderStats and hands the
+// result over under renderStatsMutex.
+FrameStats frameStats;
+FrameStats renderStats;
+// Size of the framebuffer renderFrame draws into, or 0 for the window's
+int renderTargetWidth = 0;
+int renderTargetHeight = 0;
+std::mutex renderStatsMutex;
+std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
 
 const glm::vec3 boxDimensions(180, 90, 90);
 const glm::vec3 padDimensions(30, 3, 40);
 
+const glm::vec3 cameraPosition(0, 2, -20);
+const float fieldOfView = glm::radians(80.0f);
+// Levels of detail are chosen so that no mesh strays further than this from its surface, in pixels
+const float lodPixelError = 0.5f;
+// The ball's 40x40 sphere can be halved three times
+const int ballLODLevels = 4;
+
+// Wall bounces resolved within one step; more would take a step of many seconds
+const int ballMaxBounces = 16;
+// How far past the edge of the pad the ball's centre may land and still hit it, to absorb rounding
+const float ballContactTolerance = 0.01f;
+
 glm::vec3 ballPosition(0, ballRadius + padDimensions.y, boxDimensions.z / 2);
 glm::vec3 ballDirection(1, 1, 0.2f);
 
@@ -75,7 +140,6 @@ CommandLineOptions options;
 
 bool hasStarted = false;
 bool hasLost = false;
-bool jumpedToNextFrame = false;
 bool isPaused = false;
 
 bool mouseLeftPressed = false;
@@ -90,29 +154,79 @@ double totalElapsedTime = debug_startTime;
 double gameElapsedTime = debug_startTime;
 
 double mouseSensitivity = 1.0;
-double lastMouseX = windowWidth / 2.0;
-double lastMouseY = windowHeight / 2.0;
-void mouseCallback(GLFWwindow *window, double x, double y) {
-    int windowWidth, windowHeight;
-    glfwGetWindowSize(window, &windowWidth, &windowHeight);
-    glViewport(0, 0, windowWidth, windowHeight);
+double lastMouseX = 0;
+double lastMouseY = 0;
+bool hasMousePosition = false;
+
+// Input events are only queued by the callbacks, and applied by consumeInput
+InputQueue inputQueue;
+// Time of the oldest input applied since the last frame was submitted, or -1 if there is none
+double oldestUnsubmittedInput = -1;
+// Frames simulated so far, which tells the level streamer when evicted chunks are no longer drawn
+uint64_t simulatedFrames = 0;
+// Records the input and time deltas of every frame when --record is given
+InputRecorder inputRecorder;
+// False when replaying without a window, in which case nothing is recorded for rendering
+bool renderingEnabled = false;
+
+void mouseCallback(GLFWwindow *, double x, double y) {
+    // The cursor is disabled, so positions are unbounded and only the deltas matter
+    if (hasMousePosition) {
+        InputEvent event = {InputEventType::MouseMotion, glfwGetTime(), x - lastMouseX, y - lastMouseY, 0, false};
+        inputQueue.push(event);
+    }
+    lastMouseX = x;
+    lastMouseY = y;
+    hasMousePosition = true;
+}
 
-    double deltaX = x - lastMouseX;
-    double deltaY = y - lastMouseY;
+void mouseButtonCallback(GLFWwindow *, int button, int action, int) {
+    InputEvent event = {InputEventType::MouseButton, glfwGetTime(), 0, 0, button, action == GLFW_PRESS};
+    inputQueue.push(event);
+}
 
-    padPositionX -= mouseSensitivity * deltaX / windowWidth;
-    padPositionZ -= mouseSensitivity * deltaY / windowHeight;
+// Applies all queued input. Returns whether there was any. Called by whichever thread
+// runs updateFrame.
+bool consumeInput() {
+    InputEvent event;
+    bool consumed = false;
+    while (inputQueue.pop(event)) {
+        consumed = true;
+        inputRecorder.recordEvent(event);
+        if (oldestUnsubmittedInput < 0) {
+            oldestUnsubmittedInput = event.time;
+        }
 
-    if (padPositionX > 1)
-        padPositionX = 1;
-    if (padPositionX < 0)
-        padPositionX = 0;
-    if (padPositionZ > 1)
-        padPositionZ = 1;
-    if (padPositionZ < 0)
-        padPositionZ = 0;
+        if (event.type == InputEventType::MouseMotion) {
+            padPositionX -= mouseSensitivity * event.deltaX / windowWidth;
+            padPositionZ -= mouseSensitivity * event.deltaY / windowHeight;
+            padPositionX = glm::clamp(padPositionX, 0.0, 1.0);
+            padPositionZ = glm::clamp(padPositionZ, 0.0, 1.0);
+        } else if (event.type == InputEventType::Key) {
+            if (event.code == GLFW_KEY_F1 && event.pressed) {
+                perfHud->toggle();
+            }
+        } else if (event.code == GLFW_MOUSE_BUTTON_1) {
+            // Releases are kept until updateFrame has seen them
+            mouseLeftPressed = event.pressed;
+            mouseLeftReleased |= !event.pressed;
+        } else if (event.code == GLFW_MOUSE_BUTTON_2) {
+            mouseRightPressed = event.pressed;
+            mouseRightReleased |= !event.pressed;
+        }
+    }
+    return consumed;
+}
 
-    glfwSetCursorPos(window, windowWidth / 2.0, windowHeight / 2.0);
+void keyCallback(GLFWwindow *, int key, int, int action, int) {
+    if (action != GLFW_REPEAT) {
+        InputEvent event = {InputEventType::Key, glfwGetTime(), 0, 0, key, action == GLFW_PRESS};
+        inputQueue.push(event);
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
 }
 
 //// A few lines to help you if you've never used c++ structs
@@ -121,47 +235,12 @@ void mouseCallback(GLFWwindow *window, double x, double y) {
 // };
 // LightSource lightSources[/*Put number of light sources you want here*/];
 
-void initGame(GLFWwindow *window, CommandLineOptions gameOptions) {
-    buffer = new sf::SoundBuffer();
-    if (!buffer->loadFromFile("../res/Hall of the Mountain King.ogg")) {
-        return;
-    }
+// Builds the scene graph. Makes no GL calls; the meshes and textures are attached by initGraphics.
+void initScene(CommandLineOptions gameOptions) {
+    PROFILE_ZONE("initScene");
 
     options = gameOptions;
 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
-    glfwSetCursorPosCallback(window, mouseCallback);
-
-    shader = new Gloom::Shader();
-    shader->makeBasicShader("../res/shaders/simple.vert", "../res/shaders/simple.frag");
-    shader->activate();
-
-    // Create meshes
-    Mesh pad = cube(padDimensions, glm::vec2(30, 40), true);
-    Mesh box = cube(boxDimensions, glm::vec2(90), true, true);
-    Mesh sphere = generateSphere(1.0, 40, 40);
-
-    // Fill buffers
-    unsigned int ballVAO = generateBuffer(sphere);
-    unsigned int boxVAO = generateBuffer(box);
-    unsigned int padVAO = generateBuffer(pad);
-
-    // Load charmap image
-    PNGImage charmap = loadPNGFile("../res/textures/charmap.png");
-    // Generate charmap texture
-    GLuint charmapTex = generateTexture(charmap);
-    // Generate charmap mesh
-    std::string text = "The quick brown fox jumps over the lazy dog";
-    Mesh charmapMesh =
-        generateTextGeometryBuffer(text, TEXT_CHAR_HEIGHT / TEXT_CHAR_WIDTH, TEXT_CHAR_WIDTH * text.length());
-    // Generate charmap VAO
-    GLuint charmapVao = generateBuffer(charmapMesh);
-
-    PNGImage brick = loadPNGFile("../res/textures/Brick03_col.png");
-    GLuint brickTex = generateTexture(brick);
-    PNGImage brickNormal = loadPNGFile("../res/textures/Brick03_nrm.png");
-    GLuint brickNormalTex = generateTexture(brickNormal);
-
     // Construct scene
     rootNode = createSceneNode();
     boxNode = createSceneNode();
@@ -171,55 +250,204 @@ void initGame(GLFWwindow *window, CommandLineOptions gameOptions) {
     lightNode = createSceneNode();
     // Create text nodes
     textNode = createSceneNode();
+    timerNode = createSceneNode();
 
     // Set the correct node types
     boxNode->nodeType = SceneNodeType::GEOMETRY_NORMAL_MAP;
     lightNode->nodeType = SceneNodeType::POINT_LIGHT;
     textNode->nodeType = SceneNodeType::GEOMETRY_2D;
-
-    rootNode->children.push_back(boxNode);
-    rootNode->children.push_back(padNode);
-    rootNode->children.push_back(ballNode);
-    // Add text node to the root node
-    rootNode->children.push_back(textNode);
+    timerNode->nodeType = SceneNodeType::GEOMETRY_2D;
+
+    addChild(rootNode, boxNode);
+    addChild(rootNode, padNode);
+    addChild(rootNode, ballNode);
+    // Add text nodes to the root node
+    addChild(rootNode, textNode);
+    addChild(rootNode, timerNode);
     // Add lights to the scene graph
-    rootNode->children.push_back(lightNode);
+    addChild(rootNode, lightNode);
 
     // Set the relative positions of the lights
     lightNode->position = glm::vec3(0.0, -20.0, -75.0);
 
-    // Set the position of the text node
+    boxOccluder = makeOccluder(cube(boxDimensions, glm::vec2(90), true, true));
+    boxNode->occluder = &boxOccluder;
+    occlusionCuller = new OcclusionCuller();
+    padNode->boundingRadius = glm::length(padDimensions) / 2;
+    ballNode->boundingRadius = 1;
+
+    // The overlay adds its own text nodes; toggled with F1
+    perfHud = new PerfHud(rootNode);
+
+    // Set the position and contents of the text nodes
     textNode->position = glm::vec3(0.0, float(windowHeight) - TEXT_CHAR_HEIGHT, 0.0);
+    textNode->text = "The quick brown fox jumps over the lazy dog";
+    timerNode->position = glm::vec3(0.0, float(windowHeight) - 2 * TEXT_CHAR_HEIGHT, 0.0);
+    timerNode->scale = glm::vec3(0.75);
+    timerNode->textColor = glm::vec4(1.0, 0.8, 0.2, 1.0);
+    // Updated every frame, so reserve room for it up front
+    timerNode->text.reserve(64);
+
+    if (!options.recordFile.empty()) {
+        RecordingSettings settings;
+        settings.autoplay = options.enableAutoplay;
+        inputRecorder.open(options.recordFile, settings);
+    }
 
-    boxNode->vertexArrayObjectID = boxVAO;
-    boxNode->VAOIndexCount = box.indices.size();
+    std::cout << fmt::format("Initialized scene with {} SceneNodes.", totalChildren(rootNode)) << std::endl;
+}
 
-    padNode->vertexArrayObjectID = padVAO;
-    padNode->VAOIndexCount = pad.indices.size();
+// Looks up the uniforms of the scene shader, after it is linked and after every reload
+void lookUpSceneProgram() {
+    SceneProgram program;
+    program.program = shader->get();
+    program.lightPositionLocation = shader->getUniformFromName("lights[0].position");
+    program.lightColorLocation = shader->getUniformFromName("lights[0].color");
+    // A relinked program can reuse the name of one that was deleted
+    glState->forgetProgram(program.program);
+
+    std::lock_guard<std::mutex> lock(sceneProgramMutex);
+    sceneProgram = program;
+}
+
+// Sets up input, and creates the shaders, meshes and textures of the scene built by initScene
+void initGraphics(GLFWwindow *window) {
+    PROFILE_ZONE("initGraphics");
+
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    // Unaccelerated motion straight from the mouse, where supported
+    if (glfwRawMouseMotionSupported()) {
+        glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+    }
+    glfwSetCursorPosCallback(window, mouseCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+    glfwSetKeyCallback(window, keyCallback);
 
-    ballNode->vertexArrayObjectID = ballVAO;
-    ballNode->VAOIndexCount = sphere.indices.size();
+    glState = new GLStateCache();
+    shader = new Gloom::Shader();
+    shader->makeBasicShader("../res/shaders/simple.vert", "../res/shaders/simple.frag");
+    shader->activate();
+    lookUpSceneProgram();
+
+    // Create meshes and fill buffers. The keys hold every argument of the generators, defaults included.
+    CachedBuffer pad =
+        loadCachedBuffer(geometryKey("cube", padDimensions, glm::vec2(30, 40), true, false, glm::vec3(1)),
+                         [] { return cube(padDimensions, glm::vec2(30, 40), true, false, glm::vec3(1)); });
+    CachedBuffer box =
+        loadCachedBuffer(geometryKey("cube", boxDimensions, glm::vec2(90), true, true, glm::vec3(1)),
+                         [] { return cube(boxDimensions, glm::vec2(90), true, true, glm::vec3(1)); });
+    CachedBuffer sphere = loadCachedBuffer(geometryKey("generateIndexedSphere", 1.0f, 40, 40),
+                                           [] { return generateIndexedSphere(1.0f, 40, 40); });
+
+    // Load all textures into the atlas
+    textureAtlas = new TextureAtlas();
+    unsigned int charmapTex = textureAtlas->add(loadPNGFile("../res/textures/charmap.png"), false);
+    unsigned int brickTex = textureAtlas->add(loadPNGFile("../res/textures/Brick03_col.png"), true);
+    unsigned int brickNormalTex = textureAtlas->add(loadPNGFile("../res/textures/Brick03_nrm.png"), true);
+    textureAtlas->build();
+
+    // All text is drawn as instanced glyphs from the charmap
+    textRenderer = new TextRenderer(textureAtlas->ref(charmapTex), 4096);
+
+    // Saving a shader relinks it while the game runs
+    shaderReloader = new ShaderReloader();
+    shaderReloader->add(*shader, {"../res/shaders/simple.vert", "../res/shaders/simple.frag"}, lookUpSceneProgram);
+    shaderReloader->add(textRenderer->textShader(), {"../res/shaders/text.vert", "../res/shaders/text.frag"}, [] {
+        textRenderer->setConstantUniforms();
+        glState->forgetProgram(textRenderer->textShader().get());
+    });
+    gpuProfiler = new GPUProfiler();
+
+    boxNode->vertexArrayObjectID = box.vertexArrayObjectID;
+    boxNode->VAOIndexCount = box.indexCount;
+    boxNode->VAOIndexType = box.indexType;
+
+    padNode->vertexArrayObjectID = pad.vertexArrayObjectID;
+    padNode->VAOIndexCount = pad.indexCount;
+    padNode->VAOIndexType = pad.indexType;
+
+    ballNode->vertexArrayObjectID = sphere.vertexArrayObjectID;
+    ballNode->VAOIndexCount = sphere.indexCount;
+    ballNode->VAOIndexType = sphere.indexType;
+    ballNode->lods.push_back({int(sphere.vertexArrayObjectID), sphere.indexCount, sphere.indexType,
+                              sphereTessellationError(1.0, 40, 40)});
+    // The chain is only generated if one of the coarser levels is missing from the cache
+    std::vector<Mesh> sphereLODs;
+    for (int level = 1; level < ballLODLevels; level++) {
+        std::string key = geometryKey("generateSphereLODs", 1.0f, 40, 40, ballLODLevels, level);
+        CachedBuffer lod = loadCachedBuffer(key, [&sphereLODs, level] {
+            if (sphereLODs.empty()) {
+                sphereLODs = generateSphereLODs(1.0f, 40, 40, ballLODLevels);
+            }
+            return sphereLODs[level];
+        });
+        int tessellation = 40 >> level;
+        ballNode->lods.push_back({int(lod.vertexArrayObjectID), lod.indexCount, lod.indexType,
+                                  sphereTessellationError(1.0, tessellation, tessellation)});
+    }
 
-    // Set VAO ID and index count for the charmap
-    textNode->vertexArrayObjectID = charmapVao;
-    textNode->VAOIndexCount = charmapMesh.indices.size();
+    // Set the texture locations
+    boxNode->texture = textureAtlas->ref(brickTex);
+    boxNode->normalMap = textureAtlas->ref(brickNormalTex);
 
-    // Set the texture IDs
-    boxNode->texId = brickTex;
-    boxNode->normalMapTexId = brickNormalTex;
-    textNode->texId = charmapTex;
+    // The level is loaded in the background, so the game starts right away
+    if (!options.levelDirectory.empty()) {
+        levelStreamer = new LevelStreamer(options.levelDirectory, rootNode);
+    }
 
-    getTimeDeltaSeconds();
+    renderingEnabled = true;
+}
 
-    std::cout << fmt::format("Initialized scene with {} SceneNodes.", totalChildren(rootNode)) << std::endl;
+void initGame(GLFWwindow *window, CommandLineOptions gameOptions) {
+    PROFILE_ZONE("initGame");
+
+    buffer = new sf::SoundBuffer();
+    if (!buffer->loadFromFile("../res/Hall of the Mountain King.ogg")) {
+        return;
+    }
+
+    initScene(gameOptions);
+    initGraphics(window);
+
+    getTimeDeltaSeconds();
 
     std::cout << "Ready. Click to start!" << std::endl;
 }
 
-void updateFrame(GLFWwindow *window) {
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+void updateFrame(RenderSnapshot &snapshot) {
+    updateFrame(snapshot, getTimeDeltaSeconds());
+}
 
-    double timeDelta = getTimeDeltaSeconds();
+// Before the game has started, the ball rests on the pad and follows it
+void placeBallOnPad() {
+    const float ballMinX = boxNode->position.x - (boxDimensions.x / 2) + ballRadius;
+    const float ballMaxX = boxNode->position.x + (boxDimensions.x / 2) - ballRadius;
+    const float ballMinZ = boxNode->position.z - (boxDimensions.z / 2) + ballRadius;
+    const float ballMaxZ = boxNode->position.z + (boxDimensions.z / 2) - ballRadius;
+    ballPosition.x = ballMinX + (1 - padPositionX) * (ballMaxX - ballMinX);
+    ballPosition.z = ballMinZ + (1 - padPositionZ) * (ballMaxZ - ballMinZ);
+}
+
+void updateFrame(RenderSnapshot &snapshot, double timeDelta) {
+    PROFILE_ZONE("updateFrame");
+
+    // Hand the previous frame's measurements to the overlay and start measuring this one
+    frameStats.frameMs = millisecondsSince(frameStart);
+    {
+        std::lock_guard<std::mutex> lock(renderStatsMutex);
+        frameStats.renderFrameMs = renderStats.renderFrameMs;
+        frameStats.gpuMs = renderStats.gpuMs;
+        frameStats.drawCalls = renderStats.drawCalls;
+        frameStats.triangles = renderStats.triangles;
+        frameStats.inputLatencyMs = renderStats.inputLatencyMs;
+        frameStats.inputLatencySamples = renderStats.inputLatencySamples;
+        frameStats.uploadMs = renderStats.uploadMs;
+        frameStats.glCallsIssued = renderStats.glCallsIssued;
+        frameStats.glCallsSkipped = renderStats.glCallsSkipped;
+    }
+    perfHud->update(frameStats);
+    frameStats = FrameStats();
+    frameStart = std::chrono::steady_clock::now();
 
     const float ballBottomY = boxNode->position.y - (boxDimensions.y / 2) + ballRadius + padDimensions.y;
     const float ballTopY = boxNode->position.y + (boxDimensions.y / 2) - ballRadius;
@@ -233,20 +461,10 @@ void updateFrame(GLFWwindow *window) {
     const float ballMinZ = boxNode->position.z - (boxDimensions.z / 2) + ballRadius;
     const float ballMaxZ = boxNode->position.z + (boxDimensions.z / 2) - ballRadius - cameraWallOffset;
 
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1)) {
-        mouseLeftPressed = true;
-        mouseLeftReleased = false;
-    } else {
-        mouseLeftReleased = mouseLeftPressed;
-        mouseLeftPressed = false;
-    }
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_2)) {
-        mouseRightPressed = true;
-        mouseRightReleased = false;
-    } else {
-        mouseRightReleased = mouseRightPressed;
-        mouseRightPressed = false;
-    }
+    consumeInput();
+    inputRecorder.endFrame(timeDelta);
+    snapshot.oldestInputTime = oldestUnsubmittedInput;
+    oldestUnsubmittedInput = -1;
 
     if (!hasStarted) {
         if (mouseLeftPressed) {
@@ -262,9 +480,8 @@ void updateFrame(GLFWwindow *window) {
             hasStarted = true;
         }
 
-        ballPosition.x = ballMinX + (1 - padPositionX) * (ballMaxX - ballMinX);
+        placeBallOnPad();
         ballPosition.y = ballBottomY;
-        ballPosition.z = ballMinZ + (1 - padPositionZ) * ((ballMaxZ + cameraWallOffset) - ballMinZ);
     } else {
         totalElapsedTime += timeDelta;
         if (hasLost) {
@@ -272,7 +489,6 @@ void updateFrame(GLFWwindow *window) {
                 hasLost = false;
                 hasStarted = false;
                 currentKeyFrame = 0;
-                previousKeyFrame = 0;
             }
         } else if (isPaused) {
             if (mouseRightReleased) {
@@ -289,16 +505,57 @@ void updateFrame(GLFWwindow *window) {
                     sound->pause();
                 }
             }
-            // Get the timing for the beat of the song
-            for (unsigned int i = currentKeyFrame; i < keyFrameTimeStamps.size(); i++) {
-                if (gameElapsedTime < keyFrameTimeStamps.at(i)) {
-                    continue;
+            // Make ball move. The step is split at every key frame it crosses, so that each
+            // landing is judged where the ball is at that moment, and within each part the ball
+            // bounces off the walls as often as it reaches them, however long the step is.
+            const float ballSpeed = 60.0f;
+            AABB walls = {boxNode->position - boxDimensions / 2.0f, boxNode->position + boxDimensions / 2.0f};
+            walls.max.z -= cameraWallOffset;
+
+            double stepTime = gameElapsedTime - timeDelta;
+            while (stepTime < gameElapsedTime && !hasLost) {
+                unsigned int keyFrame = findKeyFrame(keyFrameTimeStamps, currentKeyFrame, stepTime);
+                double keyFrameEnd = keyFrameTimeStamps.at(keyFrame + 1); // Assumes last keyframe at infinity
+                double stepEnd = std::min(gameElapsedTime, keyFrameEnd);
+
+                glm::vec3 ballVelocity(ballSpeed * ballDirection.x, 0, ballSpeed * ballDirection.z);
+                moveSphereInsideAABB(ballPosition, ballVelocity, float(ballRadius), float(stepEnd - stepTime), walls,
+                                     ballMaxBounces);
+                ballDirection.x = ballVelocity.x / ballSpeed;
+                ballDirection.z = ballVelocity.z / ballSpeed;
+                stepTime = stepEnd;
+
+                if (options.enableAutoplay) {
+                    padPositionX = 1 - (ballPosition.x - ballMinX) / (ballMaxX - ballMinX);
+                    padPositionZ = 1 - (ballPosition.z - ballMinZ) / ((ballMaxZ + cameraWallOffset) - ballMinZ);
+                }
+
+                // Check if the ball is hitting the pad when the ball lands on the
+                // bottom. If not, you just lost the game! (hehe)
+                bool isLanding = stepEnd == keyFrameEnd && keyFrameDirections.at(keyFrame + 1) == BOTTOM &&
+                                 keyFrameDirections.at(keyFrame + 2) == TOP;
+                if (isLanding) {
+                    float padLeftX = boxNode->position.x - (boxDimensions.x / 2) +
+                                     (1 - padPositionX) * (boxDimensions.x - padDimensions.x);
+                    float padFrontZ = boxNode->position.z - (boxDimensions.z / 2) +
+                                      (1 - padPositionZ) * (boxDimensions.z - padDimensions.z);
+                    float padBottomY = boxNode->position.y - (boxDimensions.y / 2);
+                    AABB pad = {glm::vec3(padLeftX, padBottomY, padFrontZ),
+                                glm::vec3(padLeftX, padBottomY, padFrontZ) + padDimensions};
+
+                    // The ball rests on the pad's top, so it hits if its centre is over it
+                    if (!pointOverAABB(ballPosition, pad, ballContactTolerance)) {
+                        hasLost = true;
+                        if (options.enableMusic) {
+                            sound->stop();
+                            delete sound;
+                        }
+                    }
                 }
-                currentKeyFrame = i;
             }
 
-            jumpedToNextFrame = currentKeyFrame != previousKeyFrame;
-            previousKeyFrame = currentKeyFrame;
+            // Get the timing for the beat of the song
+            currentKeyFrame = findKeyFrame(keyFrameTimeStamps, currentKeyFrame, gameElapsedTime);
 
             double frameStart = keyFrameTimeStamps.at(currentKeyFrame);
             double frameEnd = keyFrameTimeStamps.at(currentKeyFrame + 1); // Assumes last keyframe at infinity
@@ -322,70 +579,270 @@ void updateFrame(GLFWwindow *window) {
             } else if (currentDestination == TOP) {
                 ballYCoord = ballBottomY + BallVerticalTravelDistance * fractionFrameComplete;
             }
-
-            // Make ball move
-            const float ballSpeed = 60.0f;
-            ballPosition.x += timeDelta * ballSpeed * ballDirection.x;
             ballPosition.y = ballYCoord;
-            ballPosition.z += timeDelta * ballSpeed * ballDirection.z;
-
-            // Make ball bounce
-            if (ballPosition.x < ballMinX) {
-                ballPosition.x = ballMinX;
-                ballDirection.x *= -1;
-            } else if (ballPosition.x > ballMaxX) {
-                ballPosition.x = ballMaxX;
-                ballDirection.x *= -1;
-            }
-            if (ballPosition.z < ballMinZ) {
-                ballPosition.z = ballMinZ;
-                ballDirection.z *= -1;
-            } else if (ballPosition.z > ballMaxZ) {
-                ballPosition.z = ballMaxZ;
-                ballDirection.z *= -1;
-            }
+        }
+    }
 
-            if (options.enableAutoplay) {
-                padPositionX = 1 - (ballPosition.x - ballMinX) / (ballMaxX - ballMinX);
-                padPositionZ = 1 - (ballPosition.z - ballMinZ) / ((ballMaxZ + cameraWallOffset) - ballMinZ);
-            }
+    // The releases have been handled
+    mouseLeftReleased = false;
+    mouseRightReleased = false;
 
-            // Check if the ball is hitting the pad when the ball is at the
-            // bottom. If not, you just lost the game! (hehe)
-            if (jumpedToNextFrame && currentOrigin == BOTTOM && currentDestination == TOP) {
-                double padLeftX = boxNode->position.x - (boxDimensions.x / 2) +
-                                  (1 - padPositionX) * (boxDimensions.x - padDimensions.x);
-                double padRightX = padLeftX + padDimensions.x;
-                double padFrontZ = boxNode->position.z - (boxDimensions.z / 2) +
-                                   (1 - padPositionZ) * (boxDimensions.z - padDimensions.z);
-                double padBackZ = padFrontZ + padDimensions.z;
-
-                if (ballPosition.x < padLeftX || ballPosition.x > padRightX || ballPosition.z < padFrontZ ||
-                    ballPosition.z > padBackZ) {
-                    hasLost = true;
-                    if (options.enableMusic) {
-                        sound->stop();
-                        delete sound;
-                    }
-                }
+    char timerText[64];
+    int timerLength = snprintf(timerText, sizeof(timerText), "Time %.1f s", gameElapsedTime);
+    timerNode->text.assign(timerText, std::min<size_t>(timerLength, sizeof(timerText) - 1));
+
+    snapshot.frame = ++simulatedFrames;
+    if (levelStreamer != nullptr) {
+        levelStreamer->update(cameraPosition, snapshot.frame);
+        LevelStreamingStats streaming = levelStreamer->stats();
+        frameStats.residentChunks = streaming.residentChunks;
+        frameStats.streamingMegabytes = streaming.memoryBytes / (1024.0 * 1024.0);
+    }
+
+    updateSceneTransforms(snapshot);
+
+    frameStats.updateFrameMs = millisecondsSince(frameStart);
+}
+
+bool replayFrame(RenderSnapshot &snapshot, double timeDelta, const std::vector<InputEvent> &events) {
+    bool wasLost = hasLost;
+    for (const InputEvent &event : events) {
+        // Applying the queued events first keeps them in their recorded order
+        while (!inputQueue.push(event)) {
+            consumeInput();
+        }
+    }
+    updateFrame(snapshot, timeDelta);
+    return hasLost && !wasLost;
+}
+
+// The draws of each node type are drawn together, in this order, and measured as one GPU
+// zone. 2D geometry is drawn last, on top of the scene.
+static const char *const drawGroupZoneNames[DRAW_GROUPS] = {"GEOMETRY", "GEOMETRY_NORMAL_MAP", "GEOMETRY_2D"};
+static const int screenDrawGroup = 2;
+
+static int drawGroup(SceneNodeType nodeType) {
+    switch (nodeType) {
+    case SceneNodeType::GEOMETRY:
+        return 0;
+    case SceneNodeType::GEOMETRY_NORMAL_MAP:
+        return 1;
+    case SceneNodeType::GEOMETRY_2D:
+        return 2;
+    default:
+        return -1;
+    }
+}
+
+// Points the shader at the layers and UV rectangles of the node's textures.
+// The texture arrays themselves are bound once per frame.
+void recordTextureUniforms(const SceneNode *node, CommandBuffer &commands) {
+    commands.setUniform(9, glm::uvec4(node->texture.array, node->texture.layer, node->normalMap.array,
+                                      node->normalMap.layer));
+    commands.setUniform(10, node->texture.uvRect);
+    commands.setUniform(11, node->normalMap.uvRect);
+}
+
+// Records the draws of a subtree into the buffers of their draw groups. Only reads the
+// scene graph, so separate subtrees can be recorded in parallel.
+void recordDrawCommands(const SceneNode *node, CommandBuffer *groups) {
+    if (node->vertexArrayObjectID != -1 && !node->occluded) {
+        ShaderFlags flags = ShaderFlags::None;
+        switch (node->nodeType) {
+        case SceneNodeType::GEOMETRY:
+            flags = ShaderFlags::PhongLighting;
+            break;
+        case SceneNodeType::GEOMETRY_2D:
+            flags = ShaderFlags::Text;
+            break;
+        case SceneNodeType::GEOMETRY_NORMAL_MAP:
+            flags = ShaderFlags::PhongLighting | ShaderFlags::DiffuseMap | ShaderFlags::NormalMap;
+            break;
+        default:
+            break;
+        }
+
+        if (flags != ShaderFlags::None) {
+            CommandBuffer &commands = groups[drawGroup(node->nodeType)];
+            commands.setUniform(3, node->currentMVPMatrix);
+            commands.setUniform(4, node->currentModelMatrix);
+            commands.setUniform(5, glm::mat3(glm::transpose(glm::inverse(node->currentModelMatrix))));
+            if (node->nodeType != SceneNodeType::GEOMETRY) {
+                recordTextureUniforms(node, commands);
             }
+            commands.setUniform(8, static_cast<GLuint>(flags));
+            commands.bindVertexArray(node->vertexArrayObjectID);
+            commands.drawElements(GL_TRIANGLES, node->VAOIndexCount, node->VAOIndexType, 0);
         }
     }
 
-    glm::mat4 projection = glm::perspective(glm::radians(80.0f), float(windowWidth) / float(windowHeight), 0.1f, 350.f);
+    for (const SceneNode *child = node->firstChild; child != nullptr; child = child->nextSibling) {
+        recordDrawCommands(child, groups);
+    }
+}
+
+// Copies the text of the scene graph into the snapshot, and counts the visible nodes
+void collectText(SceneNode *node, RenderSnapshot &snapshot) {
+    switch (node->nodeType) {
+    case SceneNodeType::POINT_LIGHT:
+    case SceneNodeType::SPOT_LIGHT:
+        break;
+    case SceneNodeType::GEOMETRY:
+    case SceneNodeType::GEOMETRY_2D:
+    case SceneNodeType::GEOMETRY_NORMAL_MAP:
+        if (node->vertexArrayObjectID != -1 && !node->occluded) {
+            frameStats.visibleNodes++;
+        }
+        if (node->nodeType == SceneNodeType::GEOMETRY_2D && !node->text.empty()) {
+            TextItem text;
+            text.offset = snapshot.characters.size();
+            text.length = node->text.size();
+            text.origin = glm::vec2(node->currentModelMatrix[3].x, node->currentModelMatrix[3].y);
+            text.glyphSize = glm::vec2(TEXT_CHAR_WIDTH * node->scale.x, TEXT_CHAR_HEIGHT * node->scale.y);
+            text.color = packColor(node->textColor);
+            snapshot.characters.insert(snapshot.characters.end(), node->text.begin(), node->text.end());
+            snapshot.texts.push_back(text);
+            frameStats.visibleNodes++;
+        }
+        break;
+    }
+
+    for (SceneNode *child = node->firstChild; child != nullptr; child = child->nextSibling) {
+        collectText(child, snapshot);
+    }
+}
+
+void addOccluders(const SceneNode *node) {
+    if (node->occluder != nullptr) {
+        occlusionCuller->addOccluder(*node->occluder, node->currentMVPMatrix);
+    }
+    for (const SceneNode *child = node->firstChild; child != nullptr; child = child->nextSibling) {
+        addOccluders(child);
+    }
+}
+
+// Marks the nodes hidden behind the occluders, and returns how many there are. Occluders
+// are never culled, as they would hide themselves.
+unsigned int cullOccludedNodes(SceneNode *node) {
+    node->occluded = node->vertexArrayObjectID != -1 && node->boundingRadius > 0 && node->occluder == nullptr &&
+                     occlusionCuller->isOccluded(node->currentMVPMatrix, glm::vec3(node->boundingRadius));
+    unsigned int occludedNodes = node->occluded ? 1 : 0;
+    for (SceneNode *child = node->firstChild; child != nullptr; child = child->nextSibling) {
+        occludedNodes += cullOccludedNodes(child);
+    }
+    return occludedNodes;
+}
+
+// The pad and the nodes that move with it, whose draws latchInput can record again
+static bool followsPad(const SceneNode *node) {
+    return node == padNode || node == ballNode;
+}
+
+// Adds a draw group of every subtree to sceneCommandBuffers, inside the group's GPU zone
+static void appendDrawGroup(int group, const RenderSnapshot &snapshot) {
+    if (drawGroupZoneBegins[group].empty()) {
+        drawGroupZoneBegins[group].beginGPUZone(drawGroupZoneNames[group]);
+        drawGroupZoneEnds[group].endGPUZone();
+    }
+    size_t groupStart = sceneCommandBuffers.size();
+    for (size_t i = 0; i < sceneSubtrees.size(); i++) {
+        const CommandBuffer &commands = snapshot.subtreeCommands[i * DRAW_GROUPS + group];
+        if (!commands.empty()) {
+            sceneCommandBuffers.push_back(&commands);
+        }
+    }
+    // Groups without draws get no zone
+    if (sceneCommandBuffers.size() > groupStart) {
+        sceneCommandBuffers.insert(sceneCommandBuffers.begin() + groupStart, &drawGroupZoneBegins[group]);
+        sceneCommandBuffers.push_back(&drawGroupZoneEnds[group]);
+    }
+}
+
+// Records the draws of the nodes that follow the pad into snapshot.latchedCommands. They
+// are drawn right after snapshot.commands, so they rely on its per-frame state.
+void recordLatchedCommands(RenderSnapshot &snapshot) {
+    sceneCommandBuffers.clear();
+    for (CommandBuffer &commands : latchedGroups) {
+        commands.clear();
+        sceneCommandBuffers.push_back(&commands);
+    }
+    for (const SceneNode *child = rootNode->firstChild; child != nullptr; child = child->nextSibling) {
+        if (followsPad(child)) {
+            recordDrawCommands(child, latchedGroups);
+        }
+    }
+    mergeCommandBuffers(sceneCommandBuffers.data(), sceneCommandBuffers.size(), snapshot.latchedCommands);
+}
+
+// Records the scene pass: the per-frame state, then each draw group of every subtree of
+// the root node, merged without the state changes that turn out to be redundant. The 3D
+// groups go into snapshot.commands, the 2D group into snapshot.screenCommands, and the
+// nodes that follow the pad into snapshot.latchedCommands.
+void recordSceneCommands(const glm::vec3 &cameraPosition, RenderSnapshot &snapshot) {
+    PROFILE_ZONE("recordSceneCommands");
+
+    SceneProgram program;
+    {
+        std::lock_guard<std::mutex> lock(sceneProgramMutex);
+        program = sceneProgram;
+    }
+
+    CommandBuffer &frame = snapshot.frameCommands;
+    frame.bindProgram(program.program);
+    GLuint textureIds[MAX_TEXTURE_ARRAYS];
+    frame.bindTextures(0, textureAtlas->textureIds(textureIds), textureIds);
+    frame.setUniform(6, cameraPosition);
+    frame.setUniform(7, ballNode->position);
+    // Populate the lights uniform array with the dynamic and static lights
+    frame.setUniform(program.lightPositionLocation, glm::vec3(lightNode->currentModelMatrix * glm::vec4(0, 0, 0, 1)));
+    frame.setUniform(program.lightColorLocation, glm::vec3(1.0, 1.0, 1.0));
+
+    sceneSubtrees.clear();
+    for (const SceneNode *child = rootNode->firstChild; child != nullptr; child = child->nextSibling) {
+        if (!followsPad(child)) {
+            sceneSubtrees.push_back(child);
+        }
+    }
+    if (snapshot.subtreeCommands.size() < sceneSubtrees.size() * DRAW_GROUPS) {
+        snapshot.subtreeCommands.resize(sceneSubtrees.size() * DRAW_GROUPS);
+    }
+    // Small scenes are recorded on this thread
+    parallelFor(sceneSubtrees.size(), 8, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            recordDrawCommands(sceneSubtrees[i], &snapshot.subtreeCommands[i * DRAW_GROUPS]);
+        }
+    });
+
+    sceneCommandBuffers.clear();
+    sceneCommandBuffers.push_back(&frame);
+    for (int group = 0; group < DRAW_GROUPS; group++) {
+        if (group != screenDrawGroup) {
+            appendDrawGroup(group, snapshot);
+        }
+    }
+    mergeCommandBuffers(sceneCommandBuffers.data(), sceneCommandBuffers.size(), snapshot.commands);
+
+    sceneCommandBuffers.clear();
+    appendDrawGroup(screenDrawGroup, snapshot);
+    mergeCommandBuffers(sceneCommandBuffers.data(), sceneCommandBuffers.size(), snapshot.screenCommands);
+
+    recordLatchedCommands(snapshot);
+}
 
-    glm::vec3 cameraPosition = glm::vec3(0, 2, -20);
-    // Send the camera position as a uniform
-    glUniform3fv(6, 1, glm::value_ptr(cameraPosition));
+// The camera looks along the box, turning as the pad moves
+static glm::mat4 cameraViewProjection() {
+    glm::mat4 projection = glm::perspective(fieldOfView, float(windowWidth) / float(windowHeight), 0.1f, 350.f);
 
     // Some math to make the camera move in a nice way
     float lookRotation = -0.6 / (1 + exp(-5 * (padPositionX - 0.5))) + 0.3;
     glm::mat4 cameraTransform = glm::rotate(0.3f + 0.2f * float(-padPositionZ * padPositionZ), glm::vec3(1, 0, 0)) *
                                 glm::rotate(lookRotation, glm::vec3(0, 1, 0)) * glm::translate(-cameraPosition);
 
-    glm::mat4 VP = projection * cameraTransform;
+    return projection * cameraTransform;
+}
 
-    // Move and rotate various SceneNodes
+// Move and rotate various SceneNodes
+static void placeMovingNodes() {
     boxNode->position = {0, -10, -80};
 
     ballNode->position = ballPosition;
@@ -397,98 +854,172 @@ void updateFrame(GLFWwindow *window) {
                          boxNode->position.y - (boxDimensions.y / 2) + (padDimensions.y / 2),
                          boxNode->position.z - (boxDimensions.z / 2) + (padDimensions.z / 2) +
                              (1 - padPositionZ) * (boxDimensions.z - padDimensions.z)};
+}
 
-    updateNodeTransformations(rootNode, glm::identity<glm::mat4>(), VP);
-
-    // Send the updated ball position as a uniform
-    glUniform3fv(7, 1, glm::value_ptr(ballNode->position));
+// Moves the camera and the nodes that follow the pad to where the input since updateFrame
+// has put them, and nothing else: the nodes that follow the pad are recorded again, and
+// the other draws keep their levels of detail and occlusion from updateFrame but have
+// their MVP matrices moved to the new camera.
+void latchSceneTransforms(RenderSnapshot &snapshot) {
+    glm::mat4 VP = cameraViewProjection();
+    placeMovingNodes();
+    for (SceneNode *child = rootNode->firstChild; child != nullptr; child = child->nextSibling) {
+        if (followsPad(child)) {
+            updateNodeTransformations(child, rootNode->currentModelMatrix, VP * rootNode->currentModelMatrix);
+        }
+    }
 
-    // Populate the lights uniform array with the dynamic and static lights
-    auto lightPos = glm::vec3(lightNode->currentModelMatrix * glm::vec4(0, 0, 0, 1));
-    glUniform3fv(shader->getUniformFromName("lights[0].position"), 1, glm::value_ptr(lightPos));
-    glUniform3fv(shader->getUniformFromName("lights[0].color"), 1, glm::value_ptr(glm::vec3(1.0, 1.0, 1.0)));
+    if (renderingEnabled) {
+        snapshot.commands.premultiplyUniforms(3, VP * glm::inverse(snapshot.viewProjection));
+        snapshot.commands.replaceUniforms(7, ballNode->position);
+        recordLatchedCommands(snapshot);
+    }
+    snapshot.viewProjection = VP;
 }
 
-void updateNodeTransformations(SceneNode *node, glm::mat4 modelThusFar, glm::mat4 mvpThusFar) {
-    glm::mat4 transformationMatrix = glm::translate(node->position) * glm::translate(node->referencePoint) *
-                                     glm::rotate(node->rotation.y, glm::vec3(0, 1, 0)) *
-                                     glm::rotate(node->rotation.x, glm::vec3(1, 0, 0)) *
-                                     glm::rotate(node->rotation.z, glm::vec3(0, 0, 1)) * glm::scale(node->scale) *
-                                     glm::translate(-node->referencePoint);
+// Places the camera and the SceneNodes, and fills the snapshot with the result.
+// latchInput moves the camera and the pad again if more input arrives after this.
+void updateSceneTransforms(RenderSnapshot &snapshot) {
+    glm::mat4 VP = cameraViewProjection();
+    placeMovingNodes();
+
+    {
+        // One zone for the whole graph; a zone per node would flood the profiler
+        PROFILE_ZONE("updateNodeTransformations");
+        auto transformStart = std::chrono::steady_clock::now();
+        updateNodeTransformations(rootNode, glm::identity<glm::mat4>(), VP);
+        frameStats.transformMs += millisecondsSince(transformStart);
+    }
 
-    node->currentModelMatrix = modelThusFar * transformationMatrix;
-    node->currentMVPMatrix = mvpThusFar * transformationMatrix;
+    LODSelection lodSelection;
+    lodSelection.cameraPosition = cameraPosition;
+    lodSelection.pixelsPerUnit = float(windowHeight) / (2 * tan(fieldOfView / 2));
+    lodSelection.maxPixelError = lodPixelError;
+    LODStats lodStats;
+    selectLODs(rootNode, lodSelection, lodStats);
+    frameStats.lodFinestTriangles = lodStats.finestTriangles;
+    frameStats.lodSelectedTriangles = lodStats.selectedTriangles;
+
+    frameStats.occludedNodes = 0;
+    frameStats.occlusionMs = 0;
+    frameStats.visibleNodes = 0;
+    snapshot.clearDraws();
+    snapshot.viewProjection = VP;
+    // Headless replays draw nothing, so they skip rasterizing the occluders as well
+    if (renderingEnabled) {
+        // Nothing hidden behind the occluders is recorded for drawing
+        auto cullingStart = std::chrono::steady_clock::now();
+        occlusionCuller->beginFrame();
+        addOccluders(rootNode);
+        occlusionCuller->endFrame();
+        frameStats.occludedNodes = cullOccludedNodes(rootNode);
+        frameStats.occlusionMs = millisecondsSince(cullingStart);
+
+        recordSceneCommands(cameraPosition, snapshot);
+        collectText(rootNode, snapshot);
+        perfHud->drawGraph(snapshot.overlay);
+    }
+}
 
-    switch (node->nodeType) {
-    case SceneNodeType::GEOMETRY:
-        break;
-    case SceneNodeType::POINT_LIGHT:
-        break;
-    case SceneNodeType::SPOT_LIGHT:
-        break;
-    case SceneNodeType::GEOMETRY_2D:
-        node->currentMVPMatrix = glm::ortho(0.0f, float(windowWidth), 0.0f, float(windowHeight)) * transformationMatrix;
-        break;
-    case SceneNodeType::GEOMETRY_NORMAL_MAP:
-        break;
+void latchInput(RenderSnapshot &snapshot) {
+    PROFILE_ZONE("latchInput");
+
+    // Autoplay places the pad itself in updateFrame, so input would only move it for a frame
+    if (options.enableAutoplay) {
+        return;
     }
 
-    for (SceneNode *child : node->children) {
-        updateNodeTransformations(child, node->currentModelMatrix, node->currentMVPMatrix);
+    glfwPollEvents();
+    if (consumeInput()) {
+        if (!hasStarted) {
+            placeBallOnPad();
+        }
+        latchSceneTransforms(snapshot);
+        if (snapshot.oldestInputTime < 0) {
+            snapshot.oldestInputTime = oldestUnsubmittedInput;
+        }
+        oldestUnsubmittedInput = -1;
     }
 }
 
-void renderNode(SceneNode *node) {
-    glUniformMatrix4fv(3, 1, GL_FALSE, glm::value_ptr(node->currentMVPMatrix));
-    glUniformMatrix4fv(4, 1, GL_FALSE, glm::value_ptr(node->currentModelMatrix));
-    glm::mat3 normalTransform = glm::mat3(glm::transpose(glm::inverse(node->currentModelMatrix)));
-    glUniformMatrix3fv(5, 1, GL_FALSE, glm::value_ptr(normalTransform));
+void renderFrame(GLFWwindow *window, const RenderSnapshot &snapshot) {
+    PROFILE_ZONE("renderFrame");
 
-    switch (node->nodeType) {
-    case SceneNodeType::GEOMETRY:
-        glUniform1ui(8, static_cast<GLuint>(ShaderFlags::PhongLighting));
-        if (node->vertexArrayObjectID != -1) {
-            glBindVertexArray(node->vertexArrayObjectID);
-            glDrawElements(GL_TRIANGLES, node->VAOIndexCount, GL_UNSIGNED_INT, nullptr);
-        }
-        break;
-    case SceneNodeType::POINT_LIGHT:
-        break;
-    case SceneNodeType::SPOT_LIGHT:
-        break;
-    case SceneNodeType::GEOMETRY_2D:
-        // Bind the texture of the node to a texture unit
-        glBindTextureUnit(0, node->texId);
+    auto renderStart = std::chrono::steady_clock::now();
+    FrameStats stats;
+    glState->beginFrame();
+    gpuProfiler->beginFrame();
 
-        glUniform1ui(8, static_cast<GLuint>(ShaderFlags::Text));
-        if (node->vertexArrayObjectID != -1) {
-            glBindVertexArray(node->vertexArrayObjectID);
-            glDrawElements(GL_TRIANGLES, node->VAOIndexCount, GL_UNSIGNED_INT, nullptr);
-        }
-        break;
-    case SceneNodeType::GEOMETRY_NORMAL_MAP:
-        // Bind textures
-        glBindTextureUnit(0, node->texId);
-        glBindTextureUnit(1, node->normalMapTexId);
-
-        glUniform1ui(
-            8, static_cast<GLuint>(ShaderFlags::PhongLighting | ShaderFlags::DiffuseMap | ShaderFlags::NormalMap));
-        if (node->vertexArrayObjectID != -1) {
-            glBindVertexArray(node->vertexArrayObjectID);
-            glDrawElements(GL_TRIANGLES, node->VAOIndexCount, GL_UNSIGNED_INT, nullptr);
+    int targetWidth = renderTargetWidth;
+    int targetHeight = renderTargetHeight;
+    if (targetWidth == 0) {
+        glfwGetWindowSize(window, &targetWidth, &targetHeight);
+    }
+    glState->viewport(0, 0, targetWidth, targetHeight);
+
+    shaderReloader->update(snapshot.frame);
+
+    if (levelStreamer != nullptr) {
+        GPU_ZONE(*gpuProfiler, "streaming");
+        levelStreamer->uploadFrame(snapshot.frame);
+        stats.uploadMs = levelStreamer->lastUploadMilliseconds();
+        // Creating the vertex arrays of new chunks binds them
+        glState->invalidate();
+    }
+
+    {
+        GPU_ZONE(*gpuProfiler, "scene");
+        for (const CommandBuffer *commands :
+             {&snapshot.commands, &snapshot.latchedCommands, &snapshot.screenCommands}) {
+            CommandBufferStats sceneStats = executeCommandBuffer(*commands, *glState, gpuProfiler);
+            stats.drawCalls += sceneStats.drawCalls;
+            stats.triangles += sceneStats.triangles;
         }
-        break;
     }
 
-    for (SceneNode *child : node->children) {
-        renderNode(child);
+    // All text is queued, and drawn with a single draw call
+    textRenderer->beginFrame();
+    for (const TextItem &text : snapshot.texts) {
+        textRenderer->addText(&snapshot.characters[text.offset], text.length, text.origin, text.glyphSize,
+                              text.color);
     }
+    textRenderer->addInstances(snapshot.overlay.data(), uint32_t(snapshot.overlay.size()));
+    if (textRenderer->glyphCount() > 0) {
+        stats.drawCalls++;
+        stats.triangles += 2 * textRenderer->glyphCount();
+    }
+    {
+        GPU_ZONE(*gpuProfiler, "text");
+        textRenderer->draw(glm::ortho(0.0f, float(windowWidth), 0.0f, float(windowHeight)), *glState);
+    }
+
+    gpuProfiler->endFrame();
+
+    stats.gpuMs = gpuProfiler->lastFrameMilliseconds();
+    stats.glCallsIssued = glState->counters().issued;
+    stats.glCallsSkipped = glState->counters().skipped;
+    stats.renderFrameMs = millisecondsSince(renderStart);
+
+    std::lock_guard<std::mutex> lock(renderStatsMutex);
+    // Measured by frameSubmitted, after this
+    stats.inputLatencyMs = renderStats.inputLatencyMs;
+    stats.inputLatencySamples = renderStats.inputLatencySamples;
+    renderStats = stats;
+}
+
+void setRenderTargetSize(int width, int height) {
+    renderTargetWidth = width;
+    renderTargetHeight = height;
 }
 
-void renderFrame(GLFWwindow *window) {
-    int windowWidth, windowHeight;
-    glfwGetWindowSize(window, &windowWidth, &windowHeight);
-    glViewport(0, 0, windowWidth, windowHeight);
+void frameSubmitted(double oldestInputTime) {
+    std::lock_guard<std::mutex> lock(renderStatsMutex);
+    renderStats.inputLatencyMs = oldestInputTime >= 0 ? (glfwGetTime() - oldestInputTime) * 1000.0 : 0;
+    renderStats.inputLatencySamples = oldestInputTime >= 0 ? 1 : 0;
+}
 
-    renderNode(rootNode);
+void printRenderStats() {
+    if (levelStreamer != nullptr) {
+        levelStreamer->printStats();
+    }
 }
@@ -1,10 +1,30 @@
 #pragma once
 
 #include <GLFW/glfw3.h>
+#include <utilities/inputQueue.h>
 #include <utilities/window.hpp>
+#include <vector>
+#include "renderSnapshot.hpp"
 #include "sceneGraph.hpp"
 
-void updateNodeTransformations(SceneNode* node, glm::mat4 modelThusFar, glm::mat4 mvpThusFar);
 void initGame(GLFWwindow* window, CommandLineOptions options);
-void updateFrame(GLFWwindow* window);
-void renderFrame(GLFWwindow* window);
+void initScene(CommandLineOptions options);
+void initGraphics(GLFWwindow* window);
+// Simulates a frame and fills the snapshot. Makes no GL calls, so it may run on any thread.
+void updateFrame(RenderSnapshot& snapshot);
+void updateFrame(RenderSnapshot& snapshot, double timeDelta);
+// Simulates a recorded frame. Returns whether the game was lost in it.
+bool replayFrame(RenderSnapshot& snapshot, double timeDelta, const std::vector<InputEvent>& events);
+void updateSceneTransforms(RenderSnapshot& snapshot);
+// Polls for new input and moves the camera and the pad in the snapshot to match, without
+// updating the rest of the scene. Only for use when updateFrame runs on the main thread.
+void latchInput(RenderSnapshot& snapshot);
+void renderFrame(GLFWwindow* window, const RenderSnapshot& snapshot);
+// Makes renderFrame draw at this size instead of the window's, for a framebuffer of
+// another size such as the capture's. The scene keeps the window's aspect ratio.
+void setRenderTargetSize(int width, int height);
+// Measures the input latency of a frame once glfwSwapBuffers has returned for it, given
+// the snapshot's oldestInputTime
+void frameSubmitted(double oldestInputTime);
+// Prints what renderFrame measured over the run. Only for the thread with the GL context.
+void printRenderStats();
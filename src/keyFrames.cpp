@@ -0,0 +1,11 @@
+#include "keyFrames.hpp"
+
+unsigned int findKeyFrame(const std::vector<double> &timeStamps, unsigned int currentKeyFrame, double time) {
+    for (unsigned int i = currentKeyFrame; i < timeStamps.size(); i++) {
+        if (time < timeStamps.at(i)) {
+            continue;
+        }
+        currentKeyFrame = i;
+    }
+    return currentKeyFrame;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+enum KeyFrameAction { BOTTOM, TOP };
+
+#include <timestamps.h>
+
+// Returns the last key frame at or before time, starting the search at currentKeyFrame.
+// Key frames are never revisited, so the result is never less than currentKeyFrame.
+unsigned int findKeyFrame(const std::vector<double> &timeStamps, unsigned int currentKeyFrame, double time);
@@ -0,0 +1,349 @@
+#include "levelStreamer.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <utilities/objLoader.h>
+#include <utilities/profiler.h>
+#include <utilities/vertexFormat.h>
+
+LevelStreamer::LevelStreamer(const std::string &levelDirectory, SceneNode *parent)
+    : levelDirectory(levelDirectory), parent(parent), staging(new StagingBuffer(LEVEL_STAGING_BYTES)),
+      budget(LEVEL_UPLOAD_BUDGET_MS), loader(1, "level loader") {
+    std::string indexFile = levelDirectory + "/level.txt";
+    std::ifstream index(indexFile);
+    if (!index) {
+        fprintf(stderr, "Could not open the level index %s\n", indexFile.c_str());
+        return;
+    }
+
+    std::string line;
+    unsigned int lineNumber = 0;
+    while (std::getline(index, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        std::string first;
+        if (!(fields >> first) || first[0] == '#') {
+            continue;
+        }
+
+        if (first == "chunk") {
+            fields >> chunkSize;
+            continue;
+        }
+        Chunk chunk;
+        int x = 0;
+        int z = 0;
+        std::istringstream cell(first);
+        if (!(cell >> x) || !(fields >> z >> chunk.fileName) || chunkSize <= 0) {
+            fprintf(stderr, "%s:%u: expected \"chunk <size>\" followed by \"<x> <z> <file>\" lines\n",
+                    indexFile.c_str(), lineNumber);
+            chunks.clear();
+            return;
+        }
+        chunk.origin = glm::vec3(x * chunkSize, 0, z * chunkSize);
+        chunk.centre = chunk.origin + glm::vec3(chunkSize / 2, 0, chunkSize / 2);
+        chunks.push_back(chunk);
+    }
+
+    byDistance.resize(chunks.size());
+    for (uint32_t i = 0; i < byDistance.size(); i++) {
+        byDistance[i] = i;
+    }
+    printf("Streaming %zu level chunks of %.0f units from %s\n", chunks.size(), chunkSize, levelDirectory.c_str());
+}
+
+void LevelStreamer::update(const glm::vec3 &cameraPosition, uint64_t frame) {
+    PROFILE_ZONE("LevelStreamer::update");
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        arrived.swap(uploaded);
+    }
+    for (std::unique_ptr<Upload> &upload : arrived) {
+        attach(*upload);
+    }
+    arrived.clear();
+
+    // Chunks are columns, so only the distance on the XZ plane counts
+    for (Chunk &chunk : chunks) {
+        chunk.distance = glm::length(glm::vec2(chunk.centre.x - cameraPosition.x, chunk.centre.z - cameraPosition.z));
+    }
+    std::sort(byDistance.begin(), byDistance.end(),
+              [this](uint32_t a, uint32_t b) { return chunks[a].distance < chunks[b].distance; });
+
+    for (uint32_t i = 0; i < chunks.size(); i++) {
+        if (chunks[i].state == ChunkState::Resident && chunks[i].distance > LEVEL_EVICT_RADIUS) {
+            evict(i, frame);
+        }
+    }
+
+    // Nothing is uploaded before its size is reserved
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        arrived.swap(baked);
+    }
+    for (std::unique_ptr<Upload> &upload : arrived) {
+        if (reserve(*upload, frame)) {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            reserved.push_back(std::move(upload));
+        }
+    }
+    arrived.clear();
+
+    for (uint32_t index : byDistance) {
+        Chunk &chunk = chunks[index];
+        if (chunk.distance > LEVEL_LOAD_RADIUS || pendingChunks == LEVEL_MAX_PENDING_CHUNKS) {
+            break;
+        }
+        if (chunk.state != ChunkState::Unloaded) {
+            continue;
+        }
+        // Make room by evicting chunks further away than this one. If there are none,
+        // the chunks that are loaded already are nearer, and the rest have to wait. The
+        // size of a chunk that was never baked is unknown, so it is checked in reserve.
+        while (memoryBytes + chunk.memoryBytes > LEVEL_MEMORY_CAP && evictFurthest(chunk.distance, frame)) {
+        }
+        if (memoryBytes + chunk.memoryBytes > LEVEL_MEMORY_CAP) {
+            break;
+        }
+        load(index);
+    }
+}
+
+void LevelStreamer::load(uint32_t index) {
+    Chunk &chunk = chunks[index];
+    chunk.state = ChunkState::Pending;
+    pendingChunks++;
+
+    std::string fileName = levelDirectory + "/" + chunk.fileName;
+    loader.submit([this, index, fileName] {
+        PROFILE_ZONE("loadLevelChunk");
+
+        std::unique_ptr<Upload> upload(new Upload());
+        upload->chunk = index;
+        for (OBJObject &object : loadOBJFile(fileName)) {
+            float boundingRadius = 0;
+            for (const glm::vec3 &vertex : object.mesh.vertices) {
+                boundingRadius = std::max(boundingRadius, glm::length(vertex));
+            }
+            upload->boundingRadii.push_back(boundingRadius);
+            upload->baked.push_back(bakeMesh(object.mesh));
+            upload->bytes += upload->baked.back().vertexData.size() + upload->baked.back().indexData.size();
+        }
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        baked.push_back(std::move(upload));
+    });
+}
+
+bool LevelStreamer::reserve(const Upload &upload, uint64_t frame) {
+    Chunk &chunk = chunks[upload.chunk];
+    chunk.memoryBytes = upload.bytes;
+    while (memoryBytes + upload.bytes > LEVEL_MEMORY_CAP && evictFurthest(chunk.distance, frame)) {
+    }
+    // The camera may have moved away while the chunk was loading
+    if (memoryBytes + upload.bytes > LEVEL_MEMORY_CAP || chunk.distance > LEVEL_EVICT_RADIUS) {
+        chunk.state = ChunkState::Unloaded;
+        pendingChunks--;
+        return false;
+    }
+    memoryBytes += upload.bytes;
+    return true;
+}
+
+void LevelStreamer::attach(Upload &upload) {
+    Chunk &chunk = chunks[upload.chunk];
+    chunk.meshes = std::move(upload.meshes);
+
+    SceneNode *chunkNode = createSceneNode();
+    chunkNode->position = chunk.origin;
+    for (const ChunkMesh &mesh : chunk.meshes) {
+        SceneNode *node = createSceneNode();
+        node->vertexArrayObjectID = mesh.vertexArrayObjectID;
+        node->VAOIndexCount = mesh.indexCount;
+        node->VAOIndexType = mesh.indexType;
+        node->boundingRadius = mesh.boundingRadius;
+        addChild(chunkNode, node);
+    }
+    addChild(parent, chunkNode);
+    chunk.node = chunkNode->handle;
+
+    chunk.state = ChunkState::Resident;
+    pendingChunks--;
+    residentChunks++;
+}
+
+void LevelStreamer::evict(uint32_t index, uint64_t frame) {
+    Chunk &chunk = chunks[index];
+    if (SceneNode *node = resolveSceneNode(chunk.node)) {
+        destroySceneNode(node);
+    }
+    chunk.node = SceneNodeHandle();
+
+    // Snapshots before this frame may still draw the chunk
+    Release release;
+    release.frame = frame;
+    release.meshes = std::move(chunk.meshes);
+    chunk.meshes.clear();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        released.push_back(std::move(release));
+    }
+
+    chunk.state = ChunkState::Unloaded;
+    memoryBytes -= chunk.memoryBytes;
+    residentChunks--;
+}
+
+bool LevelStreamer::evictFurthest(float distance, uint64_t frame) {
+    for (auto index = byDistance.rbegin(); index != byDistance.rend(); ++index) {
+        const Chunk &chunk = chunks[*index];
+        if (chunk.distance <= distance) {
+            return false;
+        }
+        if (chunk.state == ChunkState::Resident) {
+            evict(*index, frame);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Creates the buffers of a mesh, to be filled through the staging buffer
+static ChunkMesh createChunkMesh(const BakedMesh &baked) {
+    ChunkMesh mesh;
+    mesh.indexCount = baked.indexCount;
+    mesh.indexType = baked.indexType;
+
+    glCreateBuffers(1, &mesh.vertexBufferID);
+    glNamedBufferStorage(mesh.vertexBufferID, baked.vertexData.size(), nullptr, 0);
+    glCreateBuffers(1, &mesh.indexBufferID);
+    glNamedBufferStorage(mesh.indexBufferID, baked.indexData.size(), nullptr, 0);
+
+    glCreateVertexArrays(1, &mesh.vertexArrayObjectID);
+    glBindVertexArray(mesh.vertexArrayObjectID);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBufferID);
+    setupVertexAttributes<PackedVertex>();
+    glVertexArrayElementBuffer(mesh.vertexArrayObjectID, mesh.indexBufferID);
+    return mesh;
+}
+
+bool LevelStreamer::continueUpload(Upload &upload) {
+    while (upload.mesh < upload.baked.size()) {
+        BakedMesh &baked = upload.baked[upload.mesh];
+        if (upload.meshes.size() == upload.mesh) {
+            if (!budget.beginStep(createCost)) {
+                return false;
+            }
+            upload.meshes.push_back(createChunkMesh(baked));
+            upload.meshes.back().boundingRadius = upload.boundingRadii[upload.mesh];
+            budget.endStep();
+        }
+        const ChunkMesh &mesh = upload.meshes.back();
+
+        const size_t vertexBytes = baked.vertexData.size();
+        const size_t totalBytes = vertexBytes + baked.indexData.size();
+        while (upload.offset < totalBytes) {
+            if (staging->bytesLeft() == 0 || !budget.beginStep(sliceCost)) {
+                return false;
+            }
+            bool vertices = upload.offset < vertexBytes;
+            const std::vector<unsigned char> &source = vertices ? baked.vertexData : baked.indexData;
+            size_t offset = vertices ? upload.offset : upload.offset - vertexBytes;
+            size_t size = std::min<size_t>(source.size() - offset, LEVEL_UPLOAD_SLICE_BYTES);
+
+            size_t copied = staging->upload(vertices ? mesh.vertexBufferID : mesh.indexBufferID, GLintptr(offset),
+                                            source.data() + offset, size);
+            upload.offset += copied;
+            budget.endStep();
+        }
+
+        // The GPU has its own copy now
+        baked = BakedMesh();
+        upload.mesh++;
+        upload.offset = 0;
+    }
+    return true;
+}
+
+bool LevelStreamer::continueDeleting() {
+    while (!deleting.empty()) {
+        Release &release = deleting.back();
+        if (release.meshes.empty()) {
+            deleting.pop_back();
+            continue;
+        }
+        if (!budget.beginStep(deleteCost)) {
+            return false;
+        }
+        const ChunkMesh &mesh = release.meshes.back();
+        glDeleteVertexArrays(1, &mesh.vertexArrayObjectID);
+        glDeleteBuffers(1, &mesh.vertexBufferID);
+        glDeleteBuffers(1, &mesh.indexBufferID);
+        release.meshes.pop_back();
+        budget.endStep();
+    }
+    return true;
+}
+
+void LevelStreamer::uploadFrame(uint64_t frame) {
+    PROFILE_ZONE("LevelStreamer::uploadFrame");
+
+    budget.beginFrame();
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (std::unique_ptr<Upload> &upload : reserved) {
+            uploading.push_back(std::move(upload));
+        }
+        reserved.clear();
+
+        auto drawn = std::partition(released.begin(), released.end(),
+                                    [frame](const Release &release) { return release.frame > frame; });
+        std::move(drawn, released.end(), std::back_inserter(deleting));
+        released.erase(drawn, released.end());
+    }
+
+    bool busy = !deleting.empty() || !uploading.empty();
+    // Freeing memory goes first, and the uploads get what is left of the budget.
+    // Chunks are uploaded one at a time, in the order they were reserved.
+    if (continueDeleting() && !uploading.empty() && staging->beginFrame()) {
+        size_t completed = 0;
+        while (completed < uploading.size() && continueUpload(*uploading[completed])) {
+            completed++;
+        }
+        staging->endFrame();
+
+        if (completed > 0) {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            for (size_t i = 0; i < completed; i++) {
+                uploaded.push_back(std::move(uploading[i]));
+            }
+        }
+        uploading.erase(uploading.begin(), uploading.begin() + completed);
+    }
+
+    uploadMs = budget.elapsedMilliseconds();
+    if (busy) {
+        uploadTimes.add(uploadMs);
+        if (uploadMs > LEVEL_UPLOAD_BUDGET_MS) {
+            framesOverBudget++;
+        }
+    }
+}
+
+void LevelStreamer::printStats() const {
+    if (uploadTimes.count == 0) {
+        return;
+    }
+    printf("Level streaming: %zu frames with uploads, mean %.3f ms, max %.3f ms, %zu over the %.1f ms budget\n",
+           uploadTimes.count, uploadTimes.mean, uploadTimes.max, framesOverBudget, LEVEL_UPLOAD_BUDGET_MS);
+}
+
+LevelStreamingStats LevelStreamer::stats() const {
+    LevelStreamingStats stats;
+    stats.residentChunks = residentChunks;
+    stats.pendingChunks = pendingChunks;
+    stats.memoryBytes = memoryBytes;
+    return stats;
+}
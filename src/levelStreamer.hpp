@@ -0,0 +1,178 @@
+#pragma once
+
+#include "sceneGraph.hpp"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utilities/frameBudget.h>
+#include <utilities/framePacer.h>
+#include <utilities/glutils.h>
+#include <utilities/stagingBuffer.h>
+#include <utilities/threadPool.h>
+#include <vector>
+
+// Chunks whose centre is closer to the camera than this are loaded
+#define LEVEL_LOAD_RADIUS 400.0f
+// Resident chunks are evicted once they are this far away. Being larger than the load
+// radius keeps a camera moving along the edge from loading and evicting the same chunks.
+#define LEVEL_EVICT_RADIUS 500.0f
+// Upper bound on the vertex and index data of the chunks that are resident or uploading.
+// A chunk's size is reserved once it is baked, before any of it is uploaded.
+#define LEVEL_MEMORY_CAP (256u << 20)
+// Chunks that may be loading or waiting for their upload at a time
+#define LEVEL_MAX_PENDING_CHUNKS 4
+// Render thread time per frame spent on creating, filling and deleting the buffers of
+// chunks, and the size of each copy, which is the smallest step the budget is split into
+#define LEVEL_UPLOAD_BUDGET_MS 1.0
+#define LEVEL_UPLOAD_SLICE_BYTES (64u << 10)
+// Staging memory per frame, which also bounds the bytes uploaded in a frame
+#define LEVEL_STAGING_BYTES (4u << 20)
+
+// The GL objects of one object in a chunk
+struct ChunkMesh {
+    GLuint vertexArrayObjectID = 0;
+    GLuint vertexBufferID = 0;
+    GLuint indexBufferID = 0;
+    unsigned int indexCount = 0;
+    unsigned int indexType = 0;
+    // Of a sphere around the chunk's corner that contains the mesh
+    float boundingRadius = 0;
+};
+
+struct LevelStreamingStats {
+    unsigned int residentChunks = 0;
+    unsigned int pendingChunks = 0;
+    size_t memoryBytes = 0;
+};
+
+// Streams a level that is split into square chunks on the XZ plane, each stored as an OBJ
+// file, in and out of the scene graph around the camera. The level directory holds an
+// index file, level.txt:
+//
+//     chunk <size>
+//     <x> <z> <file>
+//     ...
+//
+// where every chunk line places an OBJ file, relative to the directory, at the grid cell
+// (x, z). Its vertices are relative to the corner of the cell.
+//
+// Work is split over three threads so that none of them stalls for a chunk:
+//   - update, on the thread running updateFrame, decides which chunks to load and evict,
+//     and attaches and detaches their nodes
+//   - a worker thread reads and bakes the chunks, after which update reserves their size
+//     under the memory cap
+//   - uploadFrame, on the thread with the GL context, time-slices the uploads of baked
+//     chunks through a StagingBuffer, and deletes the buffers of evicted ones once no
+//     frame in flight can draw them. Each buffer created, slice copied and buffer deleted
+//     is a step of a FrameBudget.
+class LevelStreamer {
+  public:
+    // Reads the index and creates the staging buffer, so the GL context must be current.
+    // Chunks become children of parent as they finish loading.
+    LevelStreamer(const std::string &levelDirectory, SceneNode *parent);
+
+    bool isOpen() const { return !chunks.empty(); }
+
+    // Attaches the chunks uploaded since the last call, evicts chunks that are too far or
+    // do not fit under the memory cap, reserves memory for the chunks baked since the last
+    // call and starts loading the nearest missing ones. frame is the frame whose snapshot
+    // is recorded afterwards.
+    void update(const glm::vec3 &cameraPosition, uint64_t frame);
+    // Uploads within LEVEL_UPLOAD_BUDGET_MS, before drawing the snapshot of frame
+    void uploadFrame(uint64_t frame);
+
+    LevelStreamingStats stats() const;
+    // Time spent in the last uploadFrame. Only for the render thread.
+    double lastUploadMilliseconds() const { return uploadMs; }
+    // Prints the times of the frames that uploaded or deleted anything, and how many went
+    // over LEVEL_UPLOAD_BUDGET_MS. Only for the render thread.
+    void printStats() const;
+
+    LevelStreamer(LevelStreamer const &) = delete;
+    LevelStreamer &operator=(LevelStreamer const &) = delete;
+
+  private:
+    enum class ChunkState { Unloaded, Pending, Resident };
+
+    struct Chunk {
+        std::string fileName;
+        glm::vec3 origin;
+        glm::vec3 centre;
+        ChunkState state = ChunkState::Unloaded;
+        // Stops resolving if the node is destroyed along with the parent it was attached to
+        SceneNodeHandle node;
+        std::vector<ChunkMesh> meshes;
+        // Size of the chunk's meshes, known once it has been baked, 0 before then
+        size_t memoryBytes = 0;
+        float distance = 0;
+    };
+
+    // A chunk on its way from the worker to the render thread, and back to update
+    struct Upload {
+        uint32_t chunk;
+        std::vector<BakedMesh> baked;
+        std::vector<float> boundingRadii;
+        std::vector<ChunkMesh> meshes;
+        size_t bytes = 0;
+        // Progress through the vertex, then the index data of baked[mesh]
+        size_t mesh = 0;
+        size_t offset = 0;
+    };
+
+    // GL objects of an evicted chunk, deleted once frame is drawn
+    struct Release {
+        uint64_t frame;
+        std::vector<ChunkMesh> meshes;
+    };
+
+    void load(uint32_t chunk);
+    // Reserves the size of a baked chunk, evicting chunks further away to make room.
+    // Returns false, and unloads the chunk, if it does not fit or has gone out of range.
+    bool reserve(const Upload &upload, uint64_t frame);
+    void attach(Upload &upload);
+    void evict(uint32_t chunk, uint64_t frame);
+    // Evicts the resident chunk furthest away, if it is further than distance
+    bool evictFurthest(float distance, uint64_t frame);
+    // Returns whether the upload is complete, or false when the frame's budget or staging
+    // memory ran out
+    bool continueUpload(Upload &upload);
+    // Returns whether every evicted chunk's buffers are deleted, or false when the
+    // frame's budget ran out
+    bool continueDeleting();
+
+    std::string levelDirectory;
+    SceneNode *parent;
+    float chunkSize = 0;
+    std::vector<Chunk> chunks;
+    // Chunk indices, nearest first
+    std::vector<uint32_t> byDistance;
+    size_t memoryBytes = 0;
+    unsigned int pendingChunks = 0;
+    unsigned int residentChunks = 0;
+    std::vector<std::unique_ptr<Upload>> arrived;
+
+    // Owned by the render thread
+    std::unique_ptr<StagingBuffer> staging;
+    std::vector<std::unique_ptr<Upload>> uploading;
+    std::vector<Release> deleting;
+    FrameBudget budget;
+    StepCost createCost;
+    StepCost sliceCost;
+    StepCost deleteCost;
+    double uploadMs = 0;
+    RunningStats uploadTimes;
+    size_t framesOverBudget = 0;
+
+    // Handed between the threads under queueMutex
+    std::mutex queueMutex;
+    std::vector<std::unique_ptr<Upload>> baked;
+    std::vector<std::unique_ptr<Upload>> reserved;
+    std::vector<std::unique_ptr<Upload>> uploaded;
+    std::vector<Release> released;
+
+    // Declared last, so that its destructor finishes the running loads before anything
+    // they use is destroyed
+    ThreadPool loader;
+};
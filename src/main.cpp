@@ -1,6 +1,7 @@
 // Local headers
 #include "utilities/window.hpp"
 #include "program.hpp"
+#include "utilities/profiler.h"
 
 // System headers
 #include <glad/glad.h>
@@ -18,8 +19,17 @@ static void glfwErrorCallback(int error, const char *description)
 }
 
 
-GLFWwindow* initialise()
+GLFWwindow* initialise(const CommandLineOptions& options)
 {
+#ifdef GLFW_PLATFORM_NULL
+    // GLFW 3.4 can create its window without a display server. The context is then
+    // surfaceless, which Mesa's software renderer supports when there is no GPU.
+    if (options.headless)
+    {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
+
     // Initialise GLFW
     if (!glfwInit())
     {
@@ -37,7 +47,15 @@ GLFWwindow* initialise()
 
     // Set additional window options
     glfwWindowHint(GLFW_RESIZABLE, windowResizable);
-    glfwWindowHint(GLFW_SAMPLES, windowSamples);  // MSAA
+    // When capturing, the frame is drawn with MSAA offscreen and copied to the window
+    glfwWindowHint(GLFW_SAMPLES, options.captureDirectory.empty() ? windowSamples : 0);  // MSAA
+    if (options.headless)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef __linux__
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+#endif
+    }
 
     // Create window using GLFW
     GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, windowTitle.c_str(), nullptr, nullptr);
@@ -70,6 +88,19 @@ int main(int argc, const char* argb[])
     const auto& showHelp       = parser.add<bool>("help", "Show this help message.", 'h', arrrgh::Optional, false);
     const auto& enableMusic    = parser.add<bool>("enable-music", "Play background music while the game is playing", 'm', arrrgh::Optional, false);
     const auto& enableAutoplay = parser.add<bool>("autoplay", "Let the game play itself automatically. Useful for testing.", 'a', arrrgh::Optional, false);
+    const auto& maxFps         = parser.add<int>("max-fps", "Limit the frame rate. 0 means no limit.", 'f', arrrgh::Optional, 0);
+    const auto& vsync          = parser.add<bool>("vsync", "Synchronise buffer swaps with the display's refresh rate.", 'v', arrrgh::Optional, false);
+    const auto& pipeline       = parser.add<int>("pipeline-frames", "Frames the simulation may run ahead of rendering, on a separate thread (0-2). Each adds up to a frame of input latency.", 'p', arrrgh::Optional, 0);
+    const auto& traceFile      = parser.add<std::string>("trace", "Write a Chrome trace of the profiler zones to this file on exit.", 't', arrrgh::Optional, "");
+    const auto& recordFile     = parser.add<std::string>("record", "Record the input and frame times of the session to this file.", 'r', arrrgh::Optional, "");
+    const auto& replayFile     = parser.add<std::string>("replay", "Replay a recorded session as fast as possible, without a window or audio.", 'R', arrrgh::Optional, "");
+    const auto& captureDir     = parser.add<std::string>("capture", "Save every frame as an image in this directory.", 'c', arrrgh::Optional, "");
+    const auto& captureFormat  = parser.add<std::string>("capture-format", "Image format of captured frames, qoi or png.", 'F', arrrgh::Optional, "qoi");
+    const auto& captureWidth   = parser.add<int>("capture-width", "Width of captured frames, in pixels.", 'x', arrrgh::Optional, 1920);
+    const auto& captureHeight  = parser.add<int>("capture-height", "Height of captured frames, in pixels.", 'y', arrrgh::Optional, 1080);
+    const auto& headless       = parser.add<bool>("headless", "Run without showing a window, for capturing on machines without a display.", 'H', arrrgh::Optional, false);
+    const auto& frameLimit     = parser.add<int>("frames", "Exit after this many frames. 0 means no limit.", 'n', arrrgh::Optional, 0);
+    const auto& levelDir       = parser.add<std::string>("level", "Stream the chunks of the level in this directory in and out around the camera.", 'l', arrrgh::Optional, "");
 
     // If you want to add more program arguments, define them here,
     // but do not request their value here (they have not been parsed yet at this point).
@@ -94,15 +125,45 @@ int main(int argc, const char* argb[])
     CommandLineOptions options;
     options.enableMusic    = enableMusic.value();
     options.enableAutoplay = enableAutoplay.value();
+    options.maxFps         = maxFps.value();
+    options.vsync          = vsync.value();
+    options.pipelineFrames = pipeline.value();
+    options.traceFile      = traceFile.value();
+    options.recordFile     = recordFile.value();
+    options.replayFile     = replayFile.value();
+    options.captureDirectory = captureDir.value();
+    options.captureFormat  = captureFormat.value();
+    options.captureWidth   = captureWidth.value();
+    options.captureHeight  = captureHeight.value();
+    options.headless       = headless.value();
+    options.frameLimit     = frameLimit.value();
+    options.levelDirectory = levelDir.value();
+
+    PROFILE_THREAD_NAME("main");
+
+    if (!options.replayFile.empty())
+    {
+        runReplay(options);
+    }
+    else
+    {
+        // Initialise window using GLFW
+        GLFWwindow* window = initialise(options);
 
-    // Initialise window using GLFW
-    GLFWwindow* window = initialise();
+        // Run an OpenGL application using this window
+        runProgram(window, options);
 
-    // Run an OpenGL application using this window
-    runProgram(window, options);
+        // Terminate GLFW (no need to call glfwDestroyWindow)
+        glfwTerminate();
+    }
 
-    // Terminate GLFW (no need to call glfwDestroyWindow)
-    glfwTerminate();
+    if (!options.traceFile.empty())
+    {
+#ifndef GLOWBOX_PROFILING
+        fprintf(stderr, "Profiling is compiled out of release builds, the trace will be empty.\n");
+#endif
+        writeProfilerTrace(options.traceFile);
+    }
 
     return EXIT_SUCCESS;
 }
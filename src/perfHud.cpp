@@ -0,0 +1,127 @@
+#include "perfHud.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <utilities/window.hpp>
+
+#define PERF_HUD_CHAR_WIDTH 12.0f
+#define PERF_HUD_CHAR_HEIGHT 16.0f
+#define PERF_HUD_MARGIN 8.0f
+#define PERF_HUD_GRAPH_HEIGHT 60.0f
+// Frame time at the top of the graph, in milliseconds
+#define PERF_HUD_GRAPH_MAX_MS 33.3f
+#define PERF_HUD_MAX_LINE_LENGTH 32
+#define PERF_HUD_WIDTH (PERF_HUD_MAX_LINE_LENGTH * PERF_HUD_CHAR_WIDTH)
+
+PerfHud::PerfHud(SceneNode *parent) {
+    const float left = float(windowWidth) - PERF_HUD_MARGIN - PERF_HUD_WIDTH;
+    const float top = float(windowHeight) - PERF_HUD_MARGIN - PERF_HUD_GRAPH_HEIGHT - PERF_HUD_MARGIN;
+
+    for (int i = 0; i < PERF_HUD_LINES; i++) {
+        SceneNode *line = createSceneNode();
+        line->nodeType = SceneNodeType::GEOMETRY_2D;
+        line->position = glm::vec3(left, top - (i + 1) * PERF_HUD_CHAR_HEIGHT, 0);
+        line->scale = glm::vec3(PERF_HUD_CHAR_WIDTH / TEXT_CHAR_WIDTH, PERF_HUD_CHAR_HEIGHT / TEXT_CHAR_HEIGHT, 1);
+        line->textColor = glm::vec4(0.8, 1.0, 0.8, 1.0);
+        line->text.reserve(PERF_HUD_MAX_LINE_LENGTH + 1);
+        addChild(parent, line);
+        lines[i] = line;
+    }
+}
+
+void PerfHud::toggle() {
+    visible = !visible;
+    accumulated = FrameStats();
+    accumulatedFrames = 0;
+    sinceRefresh = 0;
+    for (SceneNode *line : lines) {
+        line->text.clear();
+    }
+}
+
+void PerfHud::update(const FrameStats &stats) {
+    frameTimes[graphCursor] = float(stats.frameMs);
+    graphCursor = (graphCursor + 1) % PERF_HUD_GRAPH_FRAMES;
+
+    accumulated.frameMs += stats.frameMs;
+    accumulated.updateFrameMs += stats.updateFrameMs;
+    accumulated.transformMs += stats.transformMs;
+    accumulated.renderFrameMs += stats.renderFrameMs;
+    accumulated.gpuMs += stats.gpuMs;
+    accumulated.inputLatencyMs += stats.inputLatencyMs;
+    accumulated.inputLatencySamples += stats.inputLatencySamples;
+    accumulated.drawCalls += stats.drawCalls;
+    accumulated.triangles += stats.triangles;
+    accumulated.visibleNodes += stats.visibleNodes;
+    accumulated.residentChunks += stats.residentChunks;
+    accumulated.streamingMegabytes += stats.streamingMegabytes;
+    accumulated.uploadMs += stats.uploadMs;
+    accumulated.lodFinestTriangles += stats.lodFinestTriangles;
+    accumulated.lodSelectedTriangles += stats.lodSelectedTriangles;
+    accumulated.occludedNodes += stats.occludedNodes;
+    accumulated.occlusionMs += stats.occlusionMs;
+    accumulated.glCallsIssued += stats.glCallsIssued;
+    accumulated.glCallsSkipped += stats.glCallsSkipped;
+    accumulatedFrames++;
+
+    sinceRefresh += stats.frameMs / 1000.0;
+    if (visible && sinceRefresh >= PERF_HUD_REFRESH_INTERVAL) {
+        refreshText();
+        accumulated = FrameStats();
+        accumulatedFrames = 0;
+        sinceRefresh = 0;
+    }
+}
+
+// Formats into a line's string without reallocating it
+template <class... Args> static void setLine(SceneNode *line, const char *format, Args... args) {
+    char buffer[PERF_HUD_MAX_LINE_LENGTH + 1];
+    int length = snprintf(buffer, sizeof(buffer), format, args...);
+    line->text.assign(buffer, std::max(0, std::min(length, PERF_HUD_MAX_LINE_LENGTH)));
+}
+
+void PerfHud::refreshText() {
+    const double frames = std::max(accumulatedFrames, 1u);
+    const double frameMs = accumulated.frameMs / frames;
+
+    setLine(lines[0], "frame %6.2f ms  %5.0f fps", frameMs, frameMs > 0 ? 1000.0 / frameMs : 0.0);
+    setLine(lines[1], "update %5.2f  transform %5.2f", accumulated.updateFrameMs / frames,
+            accumulated.transformMs / frames);
+    setLine(lines[2], "render %5.2f  gpu %5.2f", accumulated.renderFrameMs / frames, accumulated.gpuMs / frames);
+    setLine(lines[3], "draws %u  triangles %u", unsigned(accumulated.drawCalls / frames),
+            unsigned(accumulated.triangles / frames));
+    setLine(lines[4], "visible nodes %u", unsigned(accumulated.visibleNodes / frames));
+    setLine(lines[5], "input to submit %5.2f ms",
+            accumulated.inputLatencyMs / std::max(accumulated.inputLatencySamples, 1u));
+    setLine(lines[6], "chunks %u  %5.1f MB  up %4.2f", unsigned(accumulated.residentChunks / frames),
+            accumulated.streamingMegabytes / frames, accumulated.uploadMs / frames);
+    setLine(lines[7], "lod triangles %u of %u", unsigned(accumulated.lodSelectedTriangles / frames),
+            unsigned(accumulated.lodFinestTriangles / frames));
+    setLine(lines[8], "occluded %u  cull %5.2f ms", unsigned(accumulated.occludedNodes / frames),
+            accumulated.occlusionMs / frames);
+    setLine(lines[9], "gl calls %u  skipped %u", unsigned(accumulated.glCallsIssued / frames),
+            unsigned(accumulated.glCallsSkipped / frames));
+}
+
+void PerfHud::drawGraph(std::vector<GlyphInstance> &overlay) const {
+    if (!visible) {
+        return;
+    }
+
+    const float barWidth = PERF_HUD_WIDTH / PERF_HUD_GRAPH_FRAMES;
+    const float left = float(windowWidth) - PERF_HUD_MARGIN - PERF_HUD_WIDTH;
+    const float bottom = float(windowHeight) - PERF_HUD_MARGIN - PERF_HUD_GRAPH_HEIGHT;
+
+    overlay.push_back({glm::vec2(left, bottom), glm::vec2(PERF_HUD_WIDTH, PERF_HUD_GRAPH_HEIGHT), SOLID_GLYPH,
+                       packColor(glm::vec4(0, 0, 0, 0.5))});
+
+    // Oldest frame on the left. Bars above 60 fps are green, above 30 yellow and otherwise red.
+    const uint32_t fast = packColor(glm::vec4(0.3, 0.9, 0.3, 0.9));
+    const uint32_t slow = packColor(glm::vec4(0.9, 0.8, 0.2, 0.9));
+    const uint32_t late = packColor(glm::vec4(0.9, 0.2, 0.2, 0.9));
+    for (unsigned int i = 0; i < PERF_HUD_GRAPH_FRAMES; i++) {
+        float frameMs = frameTimes[(graphCursor + i) % PERF_HUD_GRAPH_FRAMES];
+        float height = std::min(frameMs / PERF_HUD_GRAPH_MAX_MS, 1.0f) * PERF_HUD_GRAPH_HEIGHT;
+        uint32_t color = frameMs <= 16.7f ? fast : frameMs <= PERF_HUD_GRAPH_MAX_MS ? slow : late;
+        overlay.push_back({glm::vec2(left + i * barWidth, bottom), glm::vec2(barWidth, height), SOLID_GLYPH, color});
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "sceneGraph.hpp"
+#include "textRenderer.hpp"
+#include <vector>
+
+// Frames shown in the frame time graph
+#define PERF_HUD_GRAPH_FRAMES 120
+// Text lines in the overlay
+#define PERF_HUD_LINES 10
+// Seconds between refreshes of the text, which shows averages over the interval
+#define PERF_HUD_REFRESH_INTERVAL 0.25
+
+// Everything measured during one frame
+struct FrameStats {
+    // Time since the start of the previous frame
+    double frameMs = 0;
+    double updateFrameMs = 0;
+    double transformMs = 0;
+    double renderFrameMs = 0;
+    double gpuMs = 0;
+    // Time from receiving input to glfwSwapBuffers returning for the frame that shows it.
+    // Only frames with input have a sample.
+    double inputLatencyMs = 0;
+    unsigned int inputLatencySamples = 0;
+
+    unsigned int drawCalls = 0;
+    unsigned int triangles = 0;
+    unsigned int visibleNodes = 0;
+
+    // Level streaming: resident chunks, the memory they take, and render thread time spent uploading
+    unsigned int residentChunks = 0;
+    double streamingMegabytes = 0;
+    double uploadMs = 0;
+
+    // Triangles of the nodes with levels of detail, at their finest and as drawn
+    unsigned int lodFinestTriangles = 0;
+    unsigned int lodSelectedTriangles = 0;
+
+    // Nodes hidden by the occlusion culler, and the time it took
+    unsigned int occludedNodes = 0;
+    double occlusionMs = 0;
+
+    // GL state changes made, and left out because they changed nothing
+    unsigned int glCallsIssued = 0;
+    unsigned int glCallsSkipped = 0;
+};
+
+// A toggleable overlay with a frame time graph and the contents of FrameStats.
+// The numbers are drawn by GEOMETRY_2D text nodes and the graph by solid glyphs,
+// so the whole overlay costs one draw call shared with all other text. Updating it
+// only formats into the nodes' preallocated strings, and never allocates.
+class PerfHud {
+  public:
+    // Adds the text nodes of the overlay to parent
+    explicit PerfHud(SceneNode *parent);
+
+    void toggle();
+    bool isVisible() const { return visible; }
+
+    // Records the stats of the frame that just finished. Call before updateNodeTransformations.
+    void update(const FrameStats &stats);
+
+    // Adds the frame time graph to the glyphs drawn on top of the scene
+    void drawGraph(std::vector<GlyphInstance> &overlay) const;
+
+  private:
+    void refreshText();
+
+    SceneNode *lines[PERF_HUD_LINES];
+
+    float frameTimes[PERF_HUD_GRAPH_FRAMES] = {};
+    unsigned int graphCursor = 0;
+
+    FrameStats accumulated;
+    unsigned int accumulatedFrames = 0;
+    double sinceRefresh = 0;
+    bool visible = false;
+};
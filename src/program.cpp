@@ -5,6 +5,7 @@
 #include <glm/glm.hpp>
 // glm::translate, glm::rotate, glm::scale, glm::perspective
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <iostream>
 #include <SFML/Audio.hpp>
 #include <SFML/System/Time.hpp>
@@ -13,6 +14,13 @@
 #include <utilities/shader.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <utilities/timeutils.h>
+#include <utilities/profiler.h>
+#include <utilities/framePacer.h>
+#include <utilities/frameCapture.h>
+#include <utilities/framePipeline.h>
+#include <utilities/inputRecording.h>
+#include <chrono>
+#include <thread>
 
 
 void runProgram(GLFWwindow* window, CommandLineOptions options)
@@ -36,27 +44,145 @@ void runProgram(GLFWwindow* window, CommandLineOptions options)
 
 	initGame(window, options);
 
+    // Swap immediately unless vsync was asked for, and leave the pacing to the frame limiter
+    glfwSwapInterval(options.vsync ? 1 : 0);
+    const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    FramePacer pacer(options.maxFps, options.vsync, videoMode != nullptr ? videoMode->refreshRate : 0);
+
+    // With pipelining, the next frame is simulated on its own thread while the main
+    // thread submits the current one, so a frame takes about max(update, render)
+    // rather than their sum
+    bool pipelined = options.pipelineFrames > 0;
+    FramePipeline<RenderSnapshot> pipeline(pipelined ? options.pipelineFrames : 0);
+    std::thread simulation;
+    if (pipelined)
+    {
+        simulation = std::thread([&pipeline]
+        {
+            PROFILE_THREAD_NAME("simulation");
+            while (RenderSnapshot* snapshot = pipeline.beginWrite())
+            {
+                updateFrame(*snapshot);
+                pipeline.endWrite();
+            }
+        });
+    }
+
+    // Frames are drawn offscreen and read back asynchronously while capturing
+    FrameCapture* capture = nullptr;
+    if (!options.captureDirectory.empty())
+    {
+        CaptureFormat format = options.captureFormat == "png" ? CaptureFormat::PNG : CaptureFormat::QOI;
+        capture = new FrameCapture(options.captureDirectory, options.captureWidth, options.captureHeight, windowWidth,
+                                   windowHeight, format, windowSamples);
+        setRenderTargetSize(options.captureWidth, options.captureHeight);
+    }
+    int frameCount = 0;
+
     // Rendering Loop
-    while (!glfwWindowShouldClose(window))
+    while (!glfwWindowShouldClose(window) && (options.frameLimit == 0 || frameCount < options.frameLimit))
     {
+        PROFILE_ZONE("frame");
+
+        // Wait before gathering input rather than after, so that the input is
+        // as fresh as possible when the frame is drawn
+        {
+            PROFILE_ZONE("waitForNextFrame");
+            pacer.waitForNextFrame();
+        }
+
+        // Handle other events
+        glfwPollEvents();
+        handleKeyboardInput(window);
+
+        if (capture != nullptr)
+        {
+            capture->beginFrame();
+        }
+
 	    // Clear colour and depth buffers
 	    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
-        updateFrame(window);
-        renderFrame(window);
+        if (!pipelined)
+        {
+            RenderSnapshot* snapshot = pipeline.beginWrite();
+            updateFrame(*snapshot);
+            latchInput(*snapshot);
+            pipeline.endWrite();
+        }
 
+        const RenderSnapshot* snapshot = pipeline.beginRead();
+        renderFrame(window, *snapshot);
+        double oldestInputTime = snapshot->oldestInputTime;
+        pipeline.endRead();
 
+        if (capture != nullptr)
+        {
+            capture->endFrame(!options.headless);
+        }
+        frameCount++;
 
+        // Flip buffers
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        frameSubmitted(oldestInputTime);
+    }
 
+    pipeline.close();
+    if (simulation.joinable())
+    {
+        simulation.join();
+    }
 
-        // Handle other events
-        glfwPollEvents();
-        handleKeyboardInput(window);
+    pacer.printStats();
+    printRenderStats();
+    if (capture != nullptr)
+    {
+        capture->finish();
+        capture->printStats();
+        delete capture;
+    }
+}
 
-        // Flip buffers
-        glfwSwapBuffers(window);
+
+void runReplay(CommandLineOptions options)
+{
+    InputReplay replay(options.replayFile);
+    if (!replay.isOpen())
+    {
+        return;
+    }
+
+    // Nothing is drawn or played, and the game plays by the settings it was recorded with
+    options.enableMusic    = false;
+    options.enableAutoplay = replay.settings().autoplay;
+    options.recordFile.clear();
+    initScene(options);
+
+    RenderSnapshot snapshot;
+    std::vector<InputEvent> events;
+    double timeDelta;
+    size_t frameCount = 0;
+    double simulatedTime = 0;
+
+    auto replayStart = std::chrono::steady_clock::now();
+    while (replay.nextFrame(timeDelta, events))
+    {
+        PROFILE_ZONE("frame");
+        if (replayFrame(snapshot, timeDelta, events))
+        {
+            printf("Game lost in frame %zu, %.3f s in\n", frameCount, simulatedTime + timeDelta);
+        }
+        frameCount++;
+        simulatedTime += timeDelta;
     }
+    double replaySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replayStart).count();
+
+    printf("Replayed %zu frames (%.1f s of play) in %.3f s, %.0f frames per second\n",
+           frameCount, simulatedTime, replaySeconds, frameCount / std::max(replaySeconds, 1e-9));
 }
 
 
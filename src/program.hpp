@@ -14,6 +14,10 @@
 void runProgram(GLFWwindow* window, CommandLineOptions options);
 
 
+// Replays options.replayFile as fast as possible, without a window, GL or audio
+void runReplay(CommandLineOptions options);
+
+
 // Function for handling keypresses
 void handleKeyboardInput(GLFWwindow* window);
 
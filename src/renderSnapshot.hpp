@@ -0,0 +1,65 @@
+#pragma once
+
+#include "sceneGraph.hpp"
+#include "textRenderer.hpp"
+#include "utilities/commandBuffer.h"
+#include <vector>
+
+// Node types whose draws are grouped together, each group under one GPU zone
+#define DRAW_GROUPS 3
+
+// A string stored in RenderSnapshot::characters
+struct TextItem {
+    size_t offset;
+    size_t length;
+    glm::vec2 origin;
+    glm::vec2 glyphSize;
+    uint32_t color;
+};
+
+// Everything renderFrame needs to draw a frame, recorded from the scene graph by
+// updateFrame. This lets the next frame be simulated while this one is drawn. The
+// vectors keep their capacity between frames, so filling a snapshot does not allocate
+// once the scene has stopped growing.
+struct RenderSnapshot {
+    // The scene pass, drawn in this order. commands is merged from frameCommands and the
+    // 3D draws of subtreeCommands. latchedCommands holds the draws of the nodes that follow
+    // the pad, which latchInput records again when input arrives after updateFrame, and
+    // screenCommands the 2D draws, which go on top of both.
+    CommandBuffer commands;
+    CommandBuffer latchedCommands;
+    CommandBuffer screenCommands;
+    // Per-frame state, recorded before the draws
+    CommandBuffer frameCommands;
+    // The draws of each child of the root node, recorded in parallel. Each subtree has a
+    // buffer per draw group, at subtree * DRAW_GROUPS + group.
+    std::vector<CommandBuffer> subtreeCommands;
+
+    std::vector<TextItem> texts;
+    std::vector<char> characters;
+    // Drawn on top of the text
+    std::vector<GlyphInstance> overlay;
+
+    // The camera that commands was recorded for. latchInput moves the draws in commands to
+    // a newer camera by patching their MVP matrices, rather than recording them again.
+    glm::mat4 viewProjection;
+
+    // Counts the frames simulated so far
+    uint64_t frame = 0;
+
+    // glfwGetTime() of the oldest input that affected this frame, or -1 if there was none
+    double oldestInputTime = -1;
+
+    void clearDraws() {
+        commands.clear();
+        latchedCommands.clear();
+        screenCommands.clear();
+        frameCommands.clear();
+        for (CommandBuffer &subtree : subtreeCommands) {
+            subtree.clear();
+        }
+        texts.clear();
+        characters.clear();
+        overlay.clear();
+    }
+};
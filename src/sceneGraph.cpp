@@ -1,19 +1,206 @@
 #include "sceneGraph.hpp"
+#include "utilities/window.hpp"
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <glm/gtc/matrix_transform.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+// Generations wrap around within the bits left over by the index, skipping 0 so that no
+// node has the zero handle
+static const uint32_t maxGeneration = (1u << (32 - SCENE_NODE_INDEX_BITS)) - 1;
+
+static std::vector<std::unique_ptr<SceneNode[]>> nodeChunks;
+// Destroyed nodes, linked through their nextSibling pointers
+static SceneNode* freeNodes = nullptr;
+static uint32_t allocatedNodes = 0;
+static size_t liveNodes = 0;
+
+static SceneNode* nodeAtIndex(uint32_t index) {
+	return &nodeChunks[index / SCENE_NODE_CHUNK_SIZE][index % SCENE_NODE_CHUNK_SIZE];
+}
 
 SceneNode* createSceneNode() {
-	return new SceneNode();
+	SceneNode* node = freeNodes;
+	if (node != nullptr) {
+		freeNodes = node->nextSibling;
+	} else {
+		if (allocatedNodes == 1u << SCENE_NODE_INDEX_BITS) {
+			fprintf(stderr, "Out of SceneNode handles\n");
+			abort();
+		}
+		if (allocatedNodes % SCENE_NODE_CHUNK_SIZE == 0) {
+			nodeChunks.emplace_back(new SceneNode[SCENE_NODE_CHUNK_SIZE]);
+		}
+		node = nodeAtIndex(allocatedNodes);
+		node->handle.value = (1u << SCENE_NODE_INDEX_BITS) | allocatedNodes;
+		allocatedNodes++;
+	}
+
+	// Reset the node, keeping the handle of its slot. The text and the levels of detail
+	// keep their capacity, so that reusing a slot does not allocate.
+	SceneNodeHandle handle = node->handle;
+	std::string text;
+	std::vector<MeshLOD> lods;
+	text.swap(node->text);
+	lods.swap(node->lods);
+	*node = SceneNode();
+	node->handle = handle;
+	text.clear();
+	node->text.swap(text);
+	lods.clear();
+	node->lods.swap(lods);
+
+	liveNodes++;
+	return node;
+}
+
+static void releaseSubtree(SceneNode* node) {
+	SceneNode* child = node->firstChild;
+	while (child != nullptr) {
+		SceneNode* next = child->nextSibling;
+		releaseSubtree(child);
+		child = next;
+	}
+
+	// Existing handles stop resolving, and the next node in this slot gets the new one
+	uint32_t generation = node->handle.generation() % maxGeneration + 1;
+	node->handle.value = (generation << SCENE_NODE_INDEX_BITS) | node->handle.index();
+	node->parent = nullptr;
+	node->firstChild = nullptr;
+	node->lastChild = nullptr;
+	node->previousSibling = nullptr;
+	node->nextSibling = freeNodes;
+	freeNodes = node;
+	liveNodes--;
 }
 
-// Add a child node to its parent's list of children
+void destroySceneNode(SceneNode* node) {
+	removeFromParent(node);
+	releaseSubtree(node);
+}
+
+SceneNode* resolveSceneNode(SceneNodeHandle handle) {
+	if (handle.value == 0 || handle.index() >= allocatedNodes) {
+		return nullptr;
+	}
+	SceneNode* node = nodeAtIndex(handle.index());
+	return node->handle == handle ? node : nullptr;
+}
+
+size_t liveSceneNodeCount() {
+	return liveNodes;
+}
+
+// Add a child node to the end of its parent's list of children
 void addChild(SceneNode* parent, SceneNode* child) {
-	parent->children.push_back(child);
+	removeFromParent(child);
+	child->parent = parent;
+	child->previousSibling = parent->lastChild;
+	if (parent->lastChild != nullptr) {
+		parent->lastChild->nextSibling = child;
+	} else {
+		parent->firstChild = child;
+	}
+	parent->lastChild = child;
+}
+
+void removeFromParent(SceneNode* node) {
+	SceneNode* parent = node->parent;
+	if (parent == nullptr) {
+		return;
+	}
+
+	if (node->previousSibling != nullptr) {
+		node->previousSibling->nextSibling = node->nextSibling;
+	} else {
+		parent->firstChild = node->nextSibling;
+	}
+	if (node->nextSibling != nullptr) {
+		node->nextSibling->previousSibling = node->previousSibling;
+	} else {
+		parent->lastChild = node->previousSibling;
+	}
+	node->parent = nullptr;
+	node->previousSibling = nullptr;
+	node->nextSibling = nullptr;
+}
+
+void updateNodeTransformations(SceneNode* node, glm::mat4 modelThusFar, glm::mat4 mvpThusFar) {
+	glm::mat4 transformationMatrix = glm::translate(node->position) * glm::translate(node->referencePoint) *
+	                                 glm::rotate(node->rotation.y, glm::vec3(0, 1, 0)) *
+	                                 glm::rotate(node->rotation.x, glm::vec3(1, 0, 0)) *
+	                                 glm::rotate(node->rotation.z, glm::vec3(0, 0, 1)) * glm::scale(node->scale) *
+	                                 glm::translate(-node->referencePoint);
+
+	node->currentModelMatrix = modelThusFar * transformationMatrix;
+	node->currentMVPMatrix = mvpThusFar * transformationMatrix;
+
+	switch (node->nodeType) {
+	case SceneNodeType::GEOMETRY:
+		break;
+	case SceneNodeType::POINT_LIGHT:
+		break;
+	case SceneNodeType::SPOT_LIGHT:
+		break;
+	case SceneNodeType::GEOMETRY_2D:
+		node->currentMVPMatrix = glm::ortho(0.0f, float(windowWidth), 0.0f, float(windowHeight)) * transformationMatrix;
+		break;
+	case SceneNodeType::GEOMETRY_NORMAL_MAP:
+		break;
+	}
+
+	for (SceneNode* child = node->firstChild; child != nullptr; child = child->nextSibling) {
+		updateNodeTransformations(child, node->currentModelMatrix, node->currentMVPMatrix);
+	}
+}
+
+// The coarsest level whose error stays within the budget, starting from the current level
+// so that the hysteresis applies
+static unsigned int selectLOD(const SceneNode* node, const LODSelection& selection) {
+	const glm::mat4& model = node->currentModelMatrix;
+	float scale = std::max(glm::length(glm::vec3(model[0])),
+	                       std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	float distance = glm::length(glm::vec3(model[3]) - selection.cameraPosition) - node->boundingRadius * scale;
+	if (distance <= 0) {
+		return 0;
+	}
+
+	// Pixels of error per unit of geometric error
+	float errorScale = scale * selection.pixelsPerUnit / distance;
+	unsigned int level = std::min<unsigned int>(node->currentLOD, node->lods.size() - 1);
+	while (level > 0 && node->lods[level].geometricError * errorScale > selection.maxPixelError) {
+		level--;
+	}
+	while (level + 1 < node->lods.size() &&
+	       node->lods[level + 1].geometricError * errorScale <= selection.maxPixelError * LOD_HYSTERESIS) {
+		level++;
+	}
+	return level;
+}
+
+void selectLODs(SceneNode* node, const LODSelection& selection, LODStats& stats) {
+	if (!node->lods.empty()) {
+		node->currentLOD = selectLOD(node, selection);
+		const MeshLOD& lod = node->lods[node->currentLOD];
+		node->vertexArrayObjectID = lod.vertexArrayObjectID;
+		node->VAOIndexCount = lod.indexCount;
+		node->VAOIndexType = lod.indexType;
+
+		stats.finestTriangles += node->lods.front().indexCount / 3;
+		stats.selectedTriangles += lod.indexCount / 3;
+	}
+
+	for (SceneNode* child = node->firstChild; child != nullptr; child = child->nextSibling) {
+		selectLODs(child, selection, stats);
+	}
 }
 
 int totalChildren(SceneNode* parent) {
-	int count = parent->children.size();
-	for (SceneNode* child : parent->children) {
-		count += totalChildren(child);
+	int count = 0;
+	for (SceneNode* child = parent->firstChild; child != nullptr; child = child->nextSibling) {
+		count += 1 + totalChildren(child);
 	}
 	return count;
 }
@@ -28,7 +215,7 @@ void printNode(SceneNode* node) {
 		"    Reference point: (%f, %f, %f)\n"
 		"    VAO ID: %i\n"
 		"}\n",
-		int(node->children.size()),
+		totalChildren(node),
 		node->rotation.x, node->rotation.y, node->rotation.z,
 		node->position.x, node->position.y, node->position.z,
 		node->referencePoint.x, node->referencePoint.y, node->referencePoint.z, 
@@ -4,17 +4,52 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/mat4x4.hpp>
 
+#include "textures.hpp"
+
 #include <chrono>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <stack>
 #include <stdbool.h>
+#include <string>
 #include <vector>
 
+struct OccluderMesh;
+
 enum class SceneNodeType { GEOMETRY, POINT_LIGHT, SPOT_LIGHT, GEOMETRY_2D, GEOMETRY_NORMAL_MAP };
 
+// Nodes are allocated from chunks of this many, which are never freed or moved
+#define SCENE_NODE_CHUNK_SIZE 1024
+// Bits of a SceneNodeHandle that hold the node's index; the rest hold its generation
+#define SCENE_NODE_INDEX_BITS 22
+// A node only switches to a coarser level of detail once the level's error on screen is
+// below this fraction of the budget, so that nodes near the threshold do not keep popping
+#define LOD_HYSTERESIS 0.75f
+
+// A reference to a SceneNode that knows when the node has been destroyed: every slot in
+// the node pool counts how often it has been reused, and resolveSceneNode only accepts
+// handles from the slot's current generation. The zero handle refers to no node.
+struct SceneNodeHandle {
+    uint32_t value = 0;
+
+    uint32_t index() const { return value & ((1u << SCENE_NODE_INDEX_BITS) - 1); }
+    uint32_t generation() const { return value >> SCENE_NODE_INDEX_BITS; }
+    bool operator==(SceneNodeHandle other) const { return value == other.value; }
+    bool operator!=(SceneNodeHandle other) const { return value != other.value; }
+};
+
+// One level of detail of a node's mesh
+struct MeshLOD {
+    int vertexArrayObjectID;
+    unsigned int indexCount;
+    unsigned int indexType;
+    // Largest distance between this level and the surface it approximates, in the node's units
+    float geometricError;
+};
+
 struct SceneNode {
     SceneNode() {
         position = glm::vec3(0, 0, 0);
@@ -24,20 +59,29 @@ struct SceneNode {
         referencePoint = glm::vec3(0, 0, 0);
         vertexArrayObjectID = -1;
         VAOIndexCount = 0;
+        VAOIndexType = GL_UNSIGNED_INT;
 
         currentMVPMatrix = glm::mat4();
         currentModelMatrix = glm::mat4();
 
         nodeType = SceneNodeType::GEOMETRY;
 
-        texId = 0;
-        normalMapTexId = 0;
+        textColor = glm::vec4(1, 1, 1, 1);
     }
 
-    // A list of all children that belong to this node.
+    // The children of this node, as a linked list through their nextSibling and
+    // previousSibling pointers.
     // For instance, in case of the scene graph of a human body shown in the assignment text, the "Upper Torso" node
-    // would contain the "Left Arm", "Right Arm", "Head" and "Lower Torso" nodes in its list of children.
-    std::vector<SceneNode *> children;
+    // would have the "Left Arm", "Right Arm", "Head" and "Lower Torso" nodes as its children.
+    // Iterate with: for (SceneNode *child = node->firstChild; child != nullptr; child = child->nextSibling)
+    SceneNode *parent = nullptr;
+    SceneNode *firstChild = nullptr;
+    SceneNode *lastChild = nullptr;
+    SceneNode *nextSibling = nullptr;
+    SceneNode *previousSibling = nullptr;
+
+    // The handle that refers to this node, until it is destroyed
+    SceneNodeHandle handle;
 
     // The node's position and rotation relative to its parent
     glm::vec3 position;
@@ -56,20 +100,76 @@ struct SceneNode {
     // The ID of the VAO containing the "appearance" of this SceneNode.
     int vertexArrayObjectID;
     unsigned int VAOIndexCount;
+    unsigned int VAOIndexType;
+
+    // Optional levels of detail, finest first. When there are any, selectLODs points the
+    // VAO fields above at the coarsest level that looks the same on screen.
+    std::vector<MeshLOD> lods;
+    unsigned int currentLOD = 0;
+    // Radius of a sphere around the node's origin that contains its mesh, in the node's units.
+    // Nodes without one are never culled.
+    float boundingRadius = 0;
+
+    // Simplified geometry that hides the nodes behind it from the occlusion culler, if any
+    const OccluderMesh *occluder = nullptr;
+    // Set by the occlusion culler when the node's mesh is hidden this frame
+    bool occluded = false;
 
     // Node type is used to determine how to handle the contents of a node
     SceneNodeType nodeType;
 
-    // Texture ID
-    unsigned int texId;
+    // Location of the diffuse texture in the texture atlas
+    TextureRef texture;
 
-    // Normal map texture ID
-    unsigned int normalMapTexId;
+    // Location of the normal map in the texture atlas
+    TextureRef normalMap;
+
+    // Text drawn by GEOMETRY_2D nodes, starting at the node's origin. Assigning to it
+    // does not allocate once it has held a string at least as long.
+    std::string text;
+    glm::vec4 textColor;
 };
 
+// Nodes come from a pool of chunks with a free list, so once the pool has grown to the
+// largest number of live nodes, creating and destroying nodes does not allocate. Nodes
+// that are close in creation order are close in memory. Not thread safe; nodes must be
+// created and destroyed by one thread at a time.
 SceneNode *createSceneNode();
+// Destroys the node and all of its descendants, and removes it from its parent. Handles
+// to the destroyed nodes stop resolving.
+void destroySceneNode(SceneNode *node);
+// Returns nullptr if the node has been destroyed
+SceneNode *resolveSceneNode(SceneNodeHandle handle);
+size_t liveSceneNodeCount();
+
+// Appends child to the parent's children, removing it from its previous parent
 void addChild(SceneNode *parent, SceneNode *child);
+void removeFromParent(SceneNode *node);
 void printNode(SceneNode *node);
 int totalChildren(SceneNode *parent);
 
+// Updates the model and MVP matrices of the node and everything below it. Only touches
+// the nodes themselves, so it runs without a GL context.
+void updateNodeTransformations(SceneNode *node, glm::mat4 modelThusFar, glm::mat4 mvpThusFar);
+
+// How selectLODs measures the error of a level on screen
+struct LODSelection {
+    glm::vec3 cameraPosition;
+    // Pixels covered by one unit at a distance of one unit: the viewport height / (2 tan(fovy / 2))
+    float pixelsPerUnit;
+    // The error budget: how far, in pixels, a level may stray from the surface
+    float maxPixelError;
+};
+
+// Triangles of the nodes with levels of detail, at the finest and at the selected levels
+struct LODStats {
+    unsigned int finestTriangles = 0;
+    unsigned int selectedTriangles = 0;
+};
+
+// Picks the level of detail of every node below node that has any, using the model
+// matrices from the last updateNodeTransformations. A level's error is projected from the
+// near side of the node's bounding sphere, which keeps it conservative up close.
+void selectLODs(SceneNode *node, const LODSelection &selection, LODStats &stats);
+
 // For more details, see SceneGraph.cpp.
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "textRenderer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+uint32_t packColor(glm::vec4 color) {
+    glm::vec4 scaled = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return uint32_t(scaled.x) | uint32_t(scaled.y) << 8 | uint32_t(scaled.z) << 16 | uint32_t(scaled.w) << 24;
+}
+
+TextRenderer::TextRenderer(TextureRef charmap, uint32_t maxGlyphsPerFrame)
+    : charmap(charmap), maxGlyphsPerFrame(maxGlyphsPerFrame) {
+    shader.makeBasicShader("../res/shaders/text.vert", "../res/shaders/text.frag");
+    setConstantUniforms();
+
+    // The buffer stays mapped for the lifetime of the renderer; coherent mapping
+    // makes the writes visible to the GPU without explicit flushes
+    GLsizeiptr bufferSize = GLsizeiptr(sizeof(GlyphInstance)) * maxGlyphsPerFrame * TEXT_RING_FRAMES;
+    GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &instanceBufferID);
+    glNamedBufferStorage(instanceBufferID, bufferSize, nullptr, mapFlags);
+    mappedInstances = static_cast<GlyphInstance *>(glMapNamedBufferRange(instanceBufferID, 0, bufferSize, mapFlags));
+
+    glCreateVertexArrays(1, &vertexArrayObjectID);
+    glVertexArrayVertexBuffer(vertexArrayObjectID, 0, instanceBufferID, 0, sizeof(GlyphInstance));
+    glVertexArrayBindingDivisor(vertexArrayObjectID, 0, 1);
+
+    glVertexArrayAttribFormat(vertexArrayObjectID, 0, 2, GL_FLOAT, GL_FALSE, offsetof(GlyphInstance, position));
+    glVertexArrayAttribFormat(vertexArrayObjectID, 1, 2, GL_FLOAT, GL_FALSE, offsetof(GlyphInstance, size));
+    glVertexArrayAttribIFormat(vertexArrayObjectID, 2, 1, GL_UNSIGNED_INT, offsetof(GlyphInstance, glyph));
+    glVertexArrayAttribFormat(vertexArrayObjectID, 3, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(GlyphInstance, color));
+    for (GLuint attribute = 0; attribute < 4; attribute++) {
+        glVertexArrayAttribBinding(vertexArrayObjectID, attribute, 0);
+        glEnableVertexArrayAttrib(vertexArrayObjectID, attribute);
+    }
+}
+
+void TextRenderer::setConstantUniforms() {
+    glProgramUniform1i(shader.get(), 2, charmap.array);
+    glProgramUniform1ui(shader.get(), 3, charmap.layer);
+    glProgramUniform4fv(shader.get(), 1, 1, glm::value_ptr(charmap.uvRect));
+}
+
+void TextRenderer::beginFrame() {
+    frameIndex = (frameIndex + 1) % TEXT_RING_FRAMES;
+    frameGlyphCount = 0;
+
+    GLsync &fence = frameFences[frameIndex];
+    if (fence != nullptr) {
+        // Normally signalled long ago; only blocks when the GPU is TEXT_RING_FRAMES behind
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+GlyphInstance *TextRenderer::reserve(uint32_t count) {
+    count = std::min(count, maxGlyphsPerFrame - frameGlyphCount);
+    GlyphInstance *instances = mappedInstances + frameIndex * maxGlyphsPerFrame + frameGlyphCount;
+    frameGlyphCount += count;
+    return instances;
+}
+
+void TextRenderer::addText(const char *text, size_t length, glm::vec2 position, glm::vec2 glyphSize,
+                           uint32_t color) {
+    uint32_t count = uint32_t(std::min<size_t>(length, maxGlyphsPerFrame - frameGlyphCount));
+    GlyphInstance *instances = reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        GlyphInstance instance;
+        instance.position = glm::vec2(position.x + i * glyphSize.x, position.y);
+        instance.size = glyphSize;
+        instance.glyph = static_cast<unsigned char>(text[i]);
+        instance.color = color;
+        // Write whole instances to the write-combined mapping, never read back from it
+        std::memcpy(&instances[i], &instance, sizeof(GlyphInstance));
+    }
+}
+
+void TextRenderer::addRectangle(glm::vec2 position, glm::vec2 size, uint32_t color) {
+    if (frameGlyphCount == maxGlyphsPerFrame) {
+        return;
+    }
+    GlyphInstance instance = {position, size, SOLID_GLYPH, color};
+    std::memcpy(reserve(1), &instance, sizeof(GlyphInstance));
+}
+
+void TextRenderer::addInstances(const GlyphInstance *instances, uint32_t count) {
+    count = std::min(count, maxGlyphsPerFrame - frameGlyphCount);
+    std::memcpy(reserve(count), instances, count * sizeof(GlyphInstance));
+}
+
+void TextRenderer::draw(const glm::mat4 &projection, GLStateCache &state) {
+    if (frameGlyphCount > 0) {
+        state.useProgram(shader.get());
+        state.uniform(0, projection);
+
+        glDisable(GL_DEPTH_TEST);
+        state.bindVertexArray(vertexArrayObjectID);
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, frameGlyphCount, frameIndex * maxGlyphsPerFrame);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    frameFences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "glad/glad.h"
+#include "textures.hpp"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <utilities/glStateCache.h>
+#include <utilities/shader.hpp>
+
+// Number of frames the GPU may lag behind before beginFrame has to wait for it
+#define TEXT_RING_FRAMES 3
+
+// Size of a character at scale 1, in pixels
+#define TEXT_CHAR_WIDTH 29.0f
+#define TEXT_CHAR_HEIGHT 39.0f
+
+// Glyph index that draws a filled rectangle in the instance's color
+#define SOLID_GLYPH 0xFFFFFFFFu
+
+// Everything needed to draw one character; expanded to a quad by text.vert
+struct GlyphInstance {
+    // Bottom left corner and size, in pixels
+    glm::vec2 position;
+    glm::vec2 size;
+    // Character code in the charmap, or SOLID_GLYPH
+    uint32_t glyph;
+    // RGBA, 8 bits per channel
+    uint32_t color;
+};
+
+uint32_t packColor(glm::vec4 color);
+
+// Draws text by writing one GlyphInstance per character straight into a persistently
+// mapped ring buffer, which holds TEXT_RING_FRAMES frames worth of glyphs. Updating
+// text only costs writing the instances, and all text added during a frame is drawn
+// with a single instanced draw call.
+class TextRenderer {
+  public:
+    TextRenderer(TextureRef charmap, uint32_t maxGlyphsPerFrame);
+
+    // Starts filling the next frame's part of the ring buffer. Waits for the GPU only
+    // if it is still reading the frame that was written TEXT_RING_FRAMES frames ago.
+    void beginFrame();
+
+    // Glyphs that do not fit in the frame are dropped
+    void addText(const char *text, size_t length, glm::vec2 position, glm::vec2 glyphSize, uint32_t color);
+    void addRectangle(glm::vec2 position, glm::vec2 size, uint32_t color);
+    void addInstances(const GlyphInstance *instances, uint32_t count);
+
+    // Draws everything added since beginFrame. Leaves the text shader active.
+    void draw(const glm::mat4 &projection, GLStateCache &state);
+
+    uint32_t glyphCount() const { return frameGlyphCount; }
+
+    Gloom::Shader &textShader() { return shader; }
+    // Sets the uniforms that stay the same from frame to frame. Has to be called again
+    // after the shader is relinked.
+    void setConstantUniforms();
+
+  private:
+    GlyphInstance *reserve(uint32_t count);
+
+    Gloom::Shader shader;
+    TextureRef charmap;
+    GLuint vertexArrayObjectID;
+    GLuint instanceBufferID;
+    GlyphInstance *mappedInstances;
+    GLsync frameFences[TEXT_RING_FRAMES] = {};
+
+    uint32_t maxGlyphsPerFrame;
+    uint32_t frameIndex = 0;
+    uint32_t frameGlyphCount = 0;
+};
@@ -1,5 +1,16 @@
 #include "textures.hpp"
 #include "glad/glad.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// Atlas layers are this wide; their height is the tallest packed column, capped at ATLAS_MAX_HEIGHT
+#define ATLAS_WIDTH 4096
+#define ATLAS_MAX_HEIGHT 4096
+// Empty border kept around (and alignment of) every packed image. Mipmaps are
+// only generated down to the level where this border shrinks to a single texel,
+// so neighbouring images never bleed into each other.
+#define ATLAS_PADDING 4
 
 GLuint generateTexture(PNGImage image) {
     GLuint textureId = 0;
@@ -13,3 +24,253 @@ GLuint generateTexture(PNGImage image) {
 
     return textureId;
 }
+
+static unsigned int alignUp(unsigned int value, unsigned int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+unsigned int TextureAtlas::add(PNGImage image, bool tiling) {
+    if (built) {
+        fprintf(stderr, "TextureAtlas::add called after build(), the image is ignored.\n");
+        return 0;
+    }
+
+    // Images too wide for an atlas layer get a layer of their own
+    if (image.width + 2 * ATLAS_PADDING > ATLAS_WIDTH || image.height + 2 * ATLAS_PADDING > ATLAS_MAX_HEIGHT) {
+        tiling = true;
+    }
+
+    unsigned int id = refs.size();
+    refs.emplace_back();
+    pendingImages.push_back({std::move(image), id});
+    pendingTiling.push_back(tiling);
+    return id;
+}
+
+unsigned int TextureAtlas::addArray(unsigned int width, unsigned int height, bool atlas) {
+    TextureArray array;
+    array.width = width;
+    array.height = height;
+    array.atlas = atlas;
+    arrays.push_back(array);
+    return arrays.size() - 1;
+}
+
+// Scales a tiling image with bilinear filtering, wrapping around the edges like GL_REPEAT
+static PNGImage resampleTiling(const PNGImage &image, unsigned int width, unsigned int height) {
+    PNGImage resized;
+    resized.width = width;
+    resized.height = height;
+    resized.pixels.resize(size_t(width) * height * 4);
+    for (unsigned int y = 0; y < height; y++) {
+        float sourceY = (y + 0.5f) * image.height / height - 0.5f;
+        float floorY = std::floor(sourceY);
+        float fractionY = sourceY - floorY;
+        unsigned int y0 = (unsigned(int(floorY) + int(image.height))) % image.height;
+        unsigned int y1 = (y0 + 1) % image.height;
+        for (unsigned int x = 0; x < width; x++) {
+            float sourceX = (x + 0.5f) * image.width / width - 0.5f;
+            float floorX = std::floor(sourceX);
+            float fractionX = sourceX - floorX;
+            unsigned int x0 = (unsigned(int(floorX) + int(image.width))) % image.width;
+            unsigned int x1 = (x0 + 1) % image.width;
+            for (unsigned int c = 0; c < 4; c++) {
+                auto texel = [&](unsigned int tx, unsigned int ty) {
+                    return float(image.pixels[(size_t(ty) * image.width + tx) * 4 + c]);
+                };
+                float top = texel(x0, y0) + (texel(x1, y0) - texel(x0, y0)) * fractionX;
+                float bottom = texel(x0, y1) + (texel(x1, y1) - texel(x0, y1)) * fractionX;
+                resized.pixels[(size_t(y) * width + x) * 4 + c] =
+                    (unsigned char)(std::min(255.0f, top + (bottom - top) * fractionY + 0.5f));
+            }
+        }
+    }
+    return resized;
+}
+
+void TextureAtlas::build() {
+    if (built) {
+        return;
+    }
+    built = true;
+
+    // Group tiling images by size, one full layer each
+    std::vector<std::vector<PendingImage *>> groups;
+    bool hasPackedImages = false;
+    for (size_t i = 0; i < pendingImages.size(); i++) {
+        if (!pendingTiling[i]) {
+            hasPackedImages = true;
+            continue;
+        }
+        PendingImage &pending = pendingImages[i];
+        auto group = std::find_if(groups.begin(), groups.end(), [&pending](const std::vector<PendingImage *> &g) {
+            return g[0]->image.width == pending.image.width && g[0]->image.height == pending.image.height;
+        });
+        if (group == groups.end()) {
+            groups.emplace_back(1, &pending);
+        } else {
+            group->push_back(&pending);
+        }
+    }
+
+    // The shader cannot sample more arrays than it has, so the sizes that do not fit are
+    // scaled to the largest of them and share the last array
+    size_t maxGroups = MAX_TEXTURE_ARRAYS - (hasPackedImages ? 1 : 0);
+    if (groups.size() > maxGroups) {
+        unsigned int width = 0;
+        unsigned int height = 0;
+        for (size_t g = maxGroups - 1; g < groups.size(); g++) {
+            width = std::max(width, groups[g][0]->image.width);
+            height = std::max(height, groups[g][0]->image.height);
+        }
+        fprintf(stderr, "TextureAtlas needs %i texture arrays, but the shader only has %i; scaling %i sizes to %ux%u\n",
+                int(groups.size() + (hasPackedImages ? 1 : 0)), MAX_TEXTURE_ARRAYS,
+                int(groups.size() - maxGroups + 1), width, height);
+        std::vector<PendingImage *> &merged = groups[maxGroups - 1];
+        for (size_t g = maxGroups; g < groups.size(); g++) {
+            merged.insert(merged.end(), groups[g].begin(), groups[g].end());
+        }
+        groups.resize(maxGroups);
+        for (PendingImage *pending : merged) {
+            if (pending->image.width != width || pending->image.height != height) {
+                pending->image = resampleTiling(pending->image, width, height);
+            }
+        }
+    }
+
+    std::vector<std::vector<PendingImage *>> arrayImages;
+    for (std::vector<PendingImage *> &group : groups) {
+        unsigned int arrayIndex = addArray(group[0]->image.width, group[0]->image.height, false);
+        for (PendingImage *pending : group) {
+            pending->layer = arrays[arrayIndex].layerCount++;
+            TextureRef &ref = refs[pending->id];
+            ref.array = arrayIndex;
+            ref.layer = pending->layer;
+        }
+        arrayImages.push_back(std::move(group));
+    }
+
+    packAtlas();
+    if (arrays.size() > arrayImages.size()) {
+        arrayImages.emplace_back();
+        for (size_t i = 0; i < pendingImages.size(); i++) {
+            if (!pendingTiling[i]) {
+                arrayImages.back().push_back(&pendingImages[i]);
+            }
+        }
+    }
+
+    for (size_t a = 0; a < arrays.size(); a++) {
+        TextureArray &array = arrays[a];
+        unsigned int mipLevels =
+            array.atlas ? unsigned(std::log2(ATLAS_PADDING)) + 1
+                        : unsigned(std::floor(std::log2(std::max(array.width, array.height)))) + 1;
+        upload(array, arrayImages[a], mipLevels);
+    }
+
+    // The pixels live on the GPU now
+    pendingImages.clear();
+    pendingTiling.clear();
+}
+
+// Shelf packer: images are sorted by height and placed left to right on rows
+// ("shelves") as tall as their first image. A new layer starts when a shelf
+// would exceed the maximum layer height.
+void TextureAtlas::packAtlas() {
+    std::vector<PendingImage *> images;
+    for (size_t i = 0; i < pendingImages.size(); i++) {
+        if (!pendingTiling[i]) {
+            images.push_back(&pendingImages[i]);
+        }
+    }
+    if (images.empty()) {
+        return;
+    }
+
+    std::sort(images.begin(), images.end(), [](const PendingImage *a, const PendingImage *b) {
+        return a->image.height > b->image.height;
+    });
+
+    unsigned int layer = 0;
+    unsigned int shelfX = ATLAS_PADDING;
+    unsigned int shelfY = ATLAS_PADDING;
+    unsigned int shelfHeight = 0;
+    unsigned int usedHeight = 0;
+
+    for (PendingImage *pending : images) {
+        unsigned int width = alignUp(pending->image.width, ATLAS_PADDING);
+        unsigned int height = alignUp(pending->image.height, ATLAS_PADDING);
+
+        if (shelfX + width + ATLAS_PADDING > ATLAS_WIDTH) {
+            shelfX = ATLAS_PADDING;
+            shelfY += shelfHeight + ATLAS_PADDING;
+            shelfHeight = 0;
+        }
+        if (shelfY + height + ATLAS_PADDING > ATLAS_MAX_HEIGHT) {
+            layer++;
+            shelfX = ATLAS_PADDING;
+            shelfY = ATLAS_PADDING;
+            shelfHeight = 0;
+        }
+
+        pending->x = shelfX;
+        pending->y = shelfY;
+        pending->layer = layer;
+
+        shelfX += width + ATLAS_PADDING;
+        shelfHeight = std::max(shelfHeight, height);
+        usedHeight = std::max(usedHeight, shelfY + shelfHeight + ATLAS_PADDING);
+    }
+
+    unsigned int arrayIndex = addArray(ATLAS_WIDTH, usedHeight, true);
+    TextureArray &atlas = arrays[arrayIndex];
+    atlas.layerCount = layer + 1;
+
+    for (PendingImage *pending : images) {
+        TextureRef &ref = refs[pending->id];
+        ref.array = arrayIndex;
+        ref.layer = pending->layer;
+        ref.uvRect = glm::vec4(float(pending->x) / atlas.width, float(pending->y) / atlas.height,
+                               float(pending->image.width) / atlas.width, float(pending->image.height) / atlas.height);
+    }
+}
+
+void TextureAtlas::upload(TextureArray &array, const std::vector<PendingImage *> &images, unsigned int mipLevels) {
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array.textureId);
+    glTextureStorage3D(array.textureId, mipLevels, GL_RGBA8, array.width, array.height, array.layerCount);
+
+    if (array.atlas) {
+        // Clear the padding so it does not bleed garbage into the lower mip levels
+        const unsigned char transparent[4] = {0, 0, 0, 0};
+        glClearTexImage(array.textureId, 0, GL_RGBA, GL_UNSIGNED_BYTE, transparent);
+    }
+
+    for (const PendingImage *pending : images) {
+        glTextureSubImage3D(array.textureId, 0, pending->x, pending->y, pending->layer, pending->image.width,
+                            pending->image.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pending->image.pixels.data());
+    }
+
+    glTextureParameteri(array.textureId, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+    glTextureParameteri(array.textureId, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(array.textureId, GL_TEXTURE_MAX_LEVEL, mipLevels - 1);
+    if (array.atlas) {
+        glTextureParameteri(array.textureId, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(array.textureId, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glGenerateTextureMipmap(array.textureId);
+}
+
+GLsizei TextureAtlas::textureIds(GLuint ids[MAX_TEXTURE_ARRAYS]) const {
+    GLsizei count = std::min<GLsizei>(arrays.size(), MAX_TEXTURE_ARRAYS);
+    for (GLsizei i = 0; i < count; i++) {
+        ids[i] = arrays[i].textureId;
+    }
+    return count;
+}
+
+void TextureAtlas::bind() const {
+    GLuint ids[MAX_TEXTURE_ARRAYS] = {0};
+    GLsizei count = textureIds(ids);
+    // One multi-bind call for every texture used in the pass
+    glBindTextures(0, count, ids);
+}
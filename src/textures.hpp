@@ -2,5 +2,69 @@
 
 #include "glad/glad.h"
 #include "utilities/imageLoader.hpp"
+#include <glm/glm.hpp>
+#include <vector>
+
+// Number of texture array units the shader exposes (textureArrays[] in simple.frag)
+#define MAX_TEXTURE_ARRAYS 4
 
 GLuint generateTexture(PNGImage image);
+
+// Where an image ended up inside the texture arrays owned by a TextureAtlas
+struct TextureRef {
+    // Index of the texture array, equal to the texture unit it is bound to
+    unsigned int array = 0;
+    // Layer within that array
+    unsigned int layer = 0;
+    // Offset (xy) and scale (zw) that map the image's UVs into the layer
+    glm::vec4 uvRect = glm::vec4(0, 0, 1, 1);
+};
+
+// Collects images and stores them in a small number of GL_TEXTURE_2D_ARRAYs, so
+// a whole render pass can run with the arrays bound once.
+//
+// Tiling images keep a full layer each (so GL_REPEAT still works) and are grouped
+// with other images of the same size. Non-tiling images are packed into shared
+// atlas layers with a shelf packer. There are never more than MAX_TEXTURE_ARRAYS
+// arrays: tiling images whose size does not fit are scaled to share an array. Call
+// build() once all images have been added, and look up the final location of each
+// image with ref() afterwards.
+class TextureAtlas {
+  public:
+    unsigned int add(PNGImage image, bool tiling);
+    void build();
+    void bind() const;
+    // Fills ids with the texture arrays in the order bind() binds them, and returns how many there are
+    GLsizei textureIds(GLuint ids[MAX_TEXTURE_ARRAYS]) const;
+
+    TextureRef ref(unsigned int id) const { return refs.at(id); }
+    size_t arrayCount() const { return arrays.size(); }
+
+  private:
+    struct PendingImage {
+        PNGImage image;
+        unsigned int id;
+        // Pixel position inside the atlas layer (only used for packed images)
+        unsigned int x = 0;
+        unsigned int y = 0;
+        unsigned int layer = 0;
+    };
+
+    struct TextureArray {
+        unsigned int width;
+        unsigned int height;
+        unsigned int layerCount = 0;
+        bool atlas = false;
+        GLuint textureId = 0;
+    };
+
+    unsigned int addArray(unsigned int width, unsigned int height, bool atlas);
+    void packAtlas();
+    void upload(TextureArray &array, const std::vector<PendingImage *> &images, unsigned int mipLevels);
+
+    std::vector<TextureArray> arrays;
+    std::vector<PendingImage> pendingImages;
+    std::vector<bool> pendingTiling;
+    std::vector<TextureRef> refs;
+    bool built = false;
+};
@@ -0,0 +1,71 @@
+#include "collision.h"
+#include <algorithm>
+
+// Walls reached within this fraction of the motion of the first one are reached together,
+// so that a sphere going into a corner bounces off both walls
+#define COLLISION_TIME_EPSILON 1e-5f
+
+bool pointOverAABB(const glm::vec3 &point, const AABB &box, float margin) {
+    return point.x >= box.min.x - margin && point.x <= box.max.x + margin && point.z >= box.min.z - margin &&
+           point.z <= box.max.z + margin;
+}
+
+bool sweepSphereInsideAABB(const glm::vec3 &centre, float radius, const glm::vec3 &motion, const AABB &box,
+                           float &timeOfImpact, glm::vec3 &normal) {
+    // The walls the centre can reach, which are the box shrunk by the radius
+    glm::vec3 low = box.min + radius;
+    glm::vec3 high = box.max - radius;
+
+    float times[3];
+    float firstTime = 2;
+    for (int axis = 0; axis < 3; axis++) {
+        times[axis] = 2;
+        if (motion[axis] > 0) {
+            times[axis] = std::max(0.0f, (high[axis] - centre[axis]) / motion[axis]);
+        } else if (motion[axis] < 0) {
+            times[axis] = std::max(0.0f, (low[axis] - centre[axis]) / motion[axis]);
+        }
+        firstTime = std::min(firstTime, times[axis]);
+    }
+    if (firstTime > 1) {
+        return false;
+    }
+
+    timeOfImpact = firstTime;
+    normal = glm::vec3(0);
+    for (int axis = 0; axis < 3; axis++) {
+        if (times[axis] <= firstTime + COLLISION_TIME_EPSILON) {
+            normal[axis] = motion[axis] > 0 ? -1.0f : 1.0f;
+        }
+    }
+    return true;
+}
+
+int moveSphereInsideAABB(glm::vec3 &centre, glm::vec3 &velocity, float radius, float duration, const AABB &box,
+                         int maxBounces) {
+    int bounces = 0;
+    float remaining = duration;
+    while (remaining > 0) {
+        glm::vec3 motion = velocity * remaining;
+        float timeOfImpact;
+        glm::vec3 normal;
+        if (bounces == maxBounces || !sweepSphereInsideAABB(centre, radius, motion, box, timeOfImpact, normal)) {
+            centre += motion;
+            break;
+        }
+
+        // Advance to the walls, and reflect off each of them
+        centre += motion * timeOfImpact;
+        for (int axis = 0; axis < 3; axis++) {
+            if (normal[axis] * velocity[axis] < 0) {
+                velocity[axis] = -velocity[axis];
+            }
+        }
+        remaining -= remaining * timeOfImpact;
+        bounces++;
+    }
+
+    // Rounding can leave the centre just beyond a wall, and so can running out of bounces
+    centre = glm::clamp(centre, box.min + radius, box.max - radius);
+    return bounces;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Axis-aligned box, from its smallest to its largest corner
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Returns whether point is above or below box, which is widened by margin on X and Z.
+// Only X and Z are tested.
+bool pointOverAABB(const glm::vec3 &point, const AABB &box, float margin);
+
+// Sweeps a sphere inside box by motion. Returns whether the sphere reaches a wall on the
+// way, in which case timeOfImpact is the fraction of the motion travelled until then, and
+// normal points into the box, away from every wall reached at that time. A sphere that
+// starts against or beyond a wall it moves towards reaches it at time 0.
+bool sweepSphereInsideAABB(const glm::vec3 &centre, float radius, const glm::vec3 &motion, const AABB &box,
+                           float &timeOfImpact, glm::vec3 &normal);
+
+// Moves a sphere inside box at velocity for duration, and bounces it off the walls it
+// reaches, as many times as it reaches them, so that no step is too long for it to stay
+// inside. After maxBounces bounces, the rest of the motion is clamped to the box.
+// Returns the number of bounces.
+int moveSphereInsideAABB(glm::vec3 &centre, glm::vec3 &velocity, float radius, float duration, const AABB &box,
+                         int maxBounces);
@@ -0,0 +1,331 @@
+#include "commandBuffer.h"
+#include "glStateCache.h"
+#include "gpuProfiler.h"
+#include <algorithm>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+// Deepest nesting of GPU zones within one buffer
+#define COMMAND_MAX_ZONE_DEPTH 16
+
+template <class Command>
+void CommandBuffer::push(CommandType type, const Command &command, const void *extra, size_t extraSize) {
+    CommandHeader header = {type, uint16_t(sizeof(CommandHeader) + sizeof(Command) + extraSize)};
+    size_t offset = bytes.size();
+    bytes.resize(offset + header.size);
+    std::memcpy(&bytes[offset], &header, sizeof(CommandHeader));
+    std::memcpy(&bytes[offset + sizeof(CommandHeader)], &command, sizeof(Command));
+    if (extraSize > 0) {
+        std::memcpy(&bytes[offset + sizeof(CommandHeader) + sizeof(Command)], extra, extraSize);
+    }
+}
+
+void CommandBuffer::pushUniform(GLint location, UniformType type, const void *value, size_t valueSize) {
+    SetUniformCommand command = {location, type, uint16_t(valueSize)};
+    push(CommandType::SetUniform, command, value, valueSize);
+}
+
+void CommandBuffer::bindProgram(GLuint program) {
+    push(CommandType::BindProgram, BindProgramCommand{program});
+}
+
+void CommandBuffer::bindTextures(GLuint first, GLsizei count, const GLuint *textures) {
+    BindTexturesCommand command = {first, std::min(count, GLsizei(COMMAND_MAX_TEXTURES)), {}};
+    std::copy(textures, textures + command.count, command.textures);
+    push(CommandType::BindTextures, command);
+}
+
+void CommandBuffer::setUniform(GLint location, GLuint value) {
+    pushUniform(location, UniformType::UInt, &value, sizeof(value));
+}
+
+void CommandBuffer::setUniform(GLint location, const glm::vec3 &value) {
+    pushUniform(location, UniformType::Vec3, glm::value_ptr(value), sizeof(value));
+}
+
+void CommandBuffer::setUniform(GLint location, const glm::vec4 &value) {
+    pushUniform(location, UniformType::Vec4, glm::value_ptr(value), sizeof(value));
+}
+
+void CommandBuffer::setUniform(GLint location, const glm::uvec4 &value) {
+    pushUniform(location, UniformType::UVec4, glm::value_ptr(value), sizeof(value));
+}
+
+void CommandBuffer::setUniform(GLint location, const glm::mat3 &value) {
+    pushUniform(location, UniformType::Mat3, glm::value_ptr(value), sizeof(value));
+}
+
+void CommandBuffer::setUniform(GLint location, const glm::mat4 &value) {
+    pushUniform(location, UniformType::Mat4, glm::value_ptr(value), sizeof(value));
+}
+
+void CommandBuffer::bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    push(CommandType::BindUniformBufferRange, BindUniformBufferRangeCommand{index, buffer, offset, size});
+}
+
+void CommandBuffer::bindVertexArray(GLuint vertexArray) {
+    push(CommandType::BindVertexArray, BindVertexArrayCommand{vertexArray});
+}
+
+void CommandBuffer::drawElements(GLenum mode, GLsizei count, GLenum type, size_t offset) {
+    push(CommandType::DrawElements, DrawElementsCommand{mode, count, type, offset});
+}
+
+void CommandBuffer::beginGPUZone(const char *name) {
+    push(CommandType::BeginGPUZone, BeginGPUZoneCommand{name});
+}
+
+void CommandBuffer::endGPUZone() {
+    CommandHeader header = {CommandType::EndGPUZone, uint16_t(sizeof(CommandHeader))};
+    const unsigned char *headerBytes = reinterpret_cast<const unsigned char *>(&header);
+    bytes.insert(bytes.end(), headerBytes, headerBytes + sizeof(CommandHeader));
+}
+
+void CommandBuffer::appendCommand(const unsigned char *command) {
+    CommandHeader header;
+    std::memcpy(&header, command, sizeof(CommandHeader));
+    bytes.insert(bytes.end(), command, command + header.size);
+}
+
+// Copies the payload of a command out of the byte stream, which has no alignment guarantees
+template <class Command> static Command readCommand(const unsigned char *command) {
+    Command payload;
+    std::memcpy(&payload, command + sizeof(CommandHeader), sizeof(Command));
+    return payload;
+}
+
+static const unsigned char *uniformValue(const unsigned char *command) {
+    return command + sizeof(CommandHeader) + sizeof(SetUniformCommand);
+}
+
+// Replaces each value of the uniforms of this type at location with patch(value)
+template <class Value, class Patch>
+static void patchUniforms(unsigned char *bytes, size_t size, GLint location, UniformType type, Patch patch) {
+    for (size_t offset = 0; offset < size;) {
+        unsigned char *command = bytes + offset;
+        CommandHeader header;
+        std::memcpy(&header, command, sizeof(CommandHeader));
+        if (header.type == CommandType::SetUniform) {
+            SetUniformCommand uniform = readCommand<SetUniformCommand>(command);
+            if (uniform.location == location && uniform.type == type) {
+                unsigned char *value = command + sizeof(CommandHeader) + sizeof(SetUniformCommand);
+                Value patched;
+                std::memcpy(&patched, value, sizeof(Value));
+                patched = patch(patched);
+                std::memcpy(value, &patched, sizeof(Value));
+            }
+        }
+        offset += header.size;
+    }
+}
+
+void CommandBuffer::premultiplyUniforms(GLint location, const glm::mat4 &matrix) {
+    patchUniforms<glm::mat4>(bytes.data(), bytes.size(), location, UniformType::Mat4,
+                             [&](const glm::mat4 &value) { return matrix * value; });
+}
+
+void CommandBuffer::replaceUniforms(GLint location, const glm::vec3 &value) {
+    patchUniforms<glm::vec3>(bytes.data(), bytes.size(), location, UniformType::Vec3,
+                             [&](const glm::vec3 &) { return value; });
+}
+
+// The state set by the commands merged so far
+struct TrackedState {
+    bool programKnown = false;
+    GLuint program = 0;
+
+    bool texturesKnown = false;
+    BindTexturesCommand textures;
+
+    bool vertexArrayKnown = false;
+    GLuint vertexArray = 0;
+
+    // Uniform values belong to the program, so these are forgotten when it changes
+    uint16_t uniformSizes[COMMAND_TRACKED_UNIFORMS] = {};
+    unsigned char uniformValues[COMMAND_TRACKED_UNIFORMS][sizeof(glm::mat4)];
+
+    bool uniformBufferKnown[COMMAND_TRACKED_UNIFORM_BUFFERS] = {};
+    BindUniformBufferRangeCommand uniformBuffers[COMMAND_TRACKED_UNIFORM_BUFFERS];
+};
+
+// Returns whether the command changes anything, and records what it changes
+static bool updateTrackedState(TrackedState &state, CommandType type, const unsigned char *command) {
+    switch (type) {
+    case CommandType::BindProgram: {
+        GLuint program = readCommand<BindProgramCommand>(command).program;
+        if (state.programKnown && state.program == program) {
+            return false;
+        }
+        state.programKnown = true;
+        state.program = program;
+        std::fill(std::begin(state.uniformSizes), std::end(state.uniformSizes), 0);
+        return true;
+    }
+    case CommandType::BindTextures: {
+        BindTexturesCommand textures = readCommand<BindTexturesCommand>(command);
+        if (state.texturesKnown && state.textures.first == textures.first && state.textures.count == textures.count &&
+            std::equal(textures.textures, textures.textures + textures.count, state.textures.textures)) {
+            return false;
+        }
+        state.texturesKnown = true;
+        state.textures = textures;
+        return true;
+    }
+    case CommandType::SetUniform: {
+        SetUniformCommand uniform = readCommand<SetUniformCommand>(command);
+        if (!state.programKnown || uniform.location < 0 || uniform.location >= COMMAND_TRACKED_UNIFORMS ||
+            uniform.valueSize > sizeof(glm::mat4)) {
+            return true;
+        }
+        uint16_t &size = state.uniformSizes[uniform.location];
+        unsigned char *value = state.uniformValues[uniform.location];
+        if (size == uniform.valueSize && std::memcmp(value, uniformValue(command), size) == 0) {
+            return false;
+        }
+        size = uniform.valueSize;
+        std::memcpy(value, uniformValue(command), size);
+        return true;
+    }
+    case CommandType::BindUniformBufferRange: {
+        BindUniformBufferRangeCommand range = readCommand<BindUniformBufferRangeCommand>(command);
+        if (range.index >= COMMAND_TRACKED_UNIFORM_BUFFERS) {
+            return true;
+        }
+        const BindUniformBufferRangeCommand &bound = state.uniformBuffers[range.index];
+        if (state.uniformBufferKnown[range.index] && bound.buffer == range.buffer && bound.offset == range.offset &&
+            bound.size == range.size) {
+            return false;
+        }
+        state.uniformBufferKnown[range.index] = true;
+        state.uniformBuffers[range.index] = range;
+        return true;
+    }
+    case CommandType::BindVertexArray: {
+        GLuint vertexArray = readCommand<BindVertexArrayCommand>(command).vertexArray;
+        if (state.vertexArrayKnown && state.vertexArray == vertexArray) {
+            return false;
+        }
+        state.vertexArrayKnown = true;
+        state.vertexArray = vertexArray;
+        return true;
+    }
+    default:
+        return true;
+    }
+}
+
+CommandBufferStats mergeCommandBuffers(const CommandBuffer *const *buffers, size_t count, CommandBuffer &output) {
+    CommandBufferStats stats;
+    TrackedState state;
+    output.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        const unsigned char *command = buffers[i]->data();
+        const unsigned char *end = command + buffers[i]->size();
+        while (command < end) {
+            CommandHeader header;
+            std::memcpy(&header, command, sizeof(CommandHeader));
+            if (updateTrackedState(state, header.type, command)) {
+                output.appendCommand(command);
+                stats.commands++;
+            } else {
+                stats.removed++;
+            }
+            command += header.size;
+        }
+    }
+    return stats;
+}
+
+// Copies a uniform's value out of the buffer, to get the alignment of the type
+template <class T> static T readUniform(const SetUniformCommand &uniform, const unsigned char *valueBytes) {
+    T value = T();
+    std::memcpy(&value, valueBytes, std::min<size_t>(uniform.valueSize, sizeof(T)));
+    return value;
+}
+
+static void setUniform(GLStateCache &state, const SetUniformCommand &uniform, const unsigned char *valueBytes) {
+    switch (uniform.type) {
+    case UniformType::UInt:
+        state.uniform(uniform.location, readUniform<GLuint>(uniform, valueBytes));
+        break;
+    case UniformType::Vec3:
+        state.uniform(uniform.location, readUniform<glm::vec3>(uniform, valueBytes));
+        break;
+    case UniformType::Vec4:
+        state.uniform(uniform.location, readUniform<glm::vec4>(uniform, valueBytes));
+        break;
+    case UniformType::UVec4:
+        state.uniform(uniform.location, readUniform<glm::uvec4>(uniform, valueBytes));
+        break;
+    case UniformType::Mat3:
+        state.uniform(uniform.location, readUniform<glm::mat3>(uniform, valueBytes));
+        break;
+    case UniformType::Mat4:
+        state.uniform(uniform.location, readUniform<glm::mat4>(uniform, valueBytes));
+        break;
+    }
+}
+
+CommandBufferStats executeCommandBuffer(const CommandBuffer &buffer, GLStateCache &state, GPUProfiler *profiler) {
+    CommandBufferStats stats;
+    unsigned int zones[COMMAND_MAX_ZONE_DEPTH];
+    unsigned int zoneDepth = 0;
+
+    const unsigned char *command = buffer.data();
+    const unsigned char *end = command + buffer.size();
+    while (command < end) {
+        CommandHeader header;
+        std::memcpy(&header, command, sizeof(CommandHeader));
+
+        switch (header.type) {
+        case CommandType::BindProgram:
+            state.useProgram(readCommand<BindProgramCommand>(command).program);
+            break;
+        case CommandType::BindTextures: {
+            BindTexturesCommand textures = readCommand<BindTexturesCommand>(command);
+            state.bindTextures(textures.first, textures.count, textures.textures);
+            break;
+        }
+        case CommandType::SetUniform:
+            setUniform(state, readCommand<SetUniformCommand>(command), uniformValue(command));
+            break;
+        case CommandType::BindUniformBufferRange: {
+            BindUniformBufferRangeCommand range = readCommand<BindUniformBufferRangeCommand>(command);
+            state.bindUniformBufferRange(range.index, range.buffer, range.offset, range.size);
+            break;
+        }
+        case CommandType::BindVertexArray:
+            state.bindVertexArray(readCommand<BindVertexArrayCommand>(command).vertexArray);
+            break;
+        case CommandType::DrawElements: {
+            DrawElementsCommand draw = readCommand<DrawElementsCommand>(command);
+            glDrawElements(draw.mode, draw.count, draw.type, reinterpret_cast<const void *>(draw.offset));
+            stats.drawCalls++;
+            if (draw.mode == GL_TRIANGLES) {
+                stats.triangles += draw.count / 3;
+            }
+            break;
+        }
+        case CommandType::BeginGPUZone:
+            if (zoneDepth < COMMAND_MAX_ZONE_DEPTH) {
+                zones[zoneDepth] = profiler != nullptr ? profiler->beginZone(readCommand<BeginGPUZoneCommand>(command).name)
+                                                       : 0;
+            }
+            zoneDepth++;
+            break;
+        case CommandType::EndGPUZone:
+            if (zoneDepth > 0) {
+                zoneDepth--;
+                if (zoneDepth < COMMAND_MAX_ZONE_DEPTH && profiler != nullptr) {
+                    profiler->endZone(zones[zoneDepth]);
+                }
+            }
+            break;
+        }
+
+        stats.commands++;
+        command += header.size;
+    }
+    return stats;
+}
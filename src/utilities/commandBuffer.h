@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Texture units a single BindTextures command can cover
+#define COMMAND_MAX_TEXTURES 8
+// Uniform locations below this are tracked when merging buffers; others are always kept
+#define COMMAND_TRACKED_UNIFORMS 32
+// Uniform buffer binding points tracked when merging buffers
+#define COMMAND_TRACKED_UNIFORM_BUFFERS 8
+
+class GLStateCache;
+class GPUProfiler;
+
+enum class CommandType : uint16_t {
+    BindProgram,
+    BindTextures,
+    SetUniform,
+    BindUniformBufferRange,
+    BindVertexArray,
+    DrawElements,
+    BeginGPUZone,
+    EndGPUZone,
+};
+
+enum class UniformType : uint16_t { UInt, Vec3, Vec4, UVec4, Mat3, Mat4 };
+
+// Every command starts with a header, and size covers the header and the payload
+struct CommandHeader {
+    CommandType type;
+    uint16_t size;
+};
+
+struct BindProgramCommand {
+    GLuint program;
+};
+
+struct BindTexturesCommand {
+    GLuint first;
+    GLsizei count;
+    GLuint textures[COMMAND_MAX_TEXTURES];
+};
+
+// Followed by the value, whose size depends on the type
+struct SetUniformCommand {
+    GLint location;
+    UniformType type;
+    uint16_t valueSize;
+};
+
+struct BindUniformBufferRangeCommand {
+    GLuint index;
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+};
+
+struct BindVertexArrayCommand {
+    GLuint vertexArray;
+};
+
+struct DrawElementsCommand {
+    GLenum mode;
+    GLsizei count;
+    GLenum type;
+    size_t offset;
+};
+
+struct BeginGPUZoneCommand {
+    // Must outlive the buffer, like the names of profiler zones
+    const char *name;
+};
+
+// A linear list of GL commands, stored as plain bytes. Recording only appends to a
+// vector and makes no GL calls, so any thread can record a buffer. The buffer is then
+// replayed on the GL thread with executeCommandBuffer. Clearing keeps the capacity, so
+// re-recording a buffer each frame does not allocate once it has reached its size.
+class CommandBuffer {
+  public:
+    void clear() { bytes.clear(); }
+    bool empty() const { return bytes.empty(); }
+    size_t size() const { return bytes.size(); }
+    const unsigned char *data() const { return bytes.data(); }
+
+    void bindProgram(GLuint program);
+    void bindTextures(GLuint first, GLsizei count, const GLuint *textures);
+    void setUniform(GLint location, GLuint value);
+    void setUniform(GLint location, const glm::vec3 &value);
+    void setUniform(GLint location, const glm::vec4 &value);
+    void setUniform(GLint location, const glm::uvec4 &value);
+    void setUniform(GLint location, const glm::mat3 &value);
+    void setUniform(GLint location, const glm::mat4 &value);
+    void bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void bindVertexArray(GLuint vertexArray);
+    void drawElements(GLenum mode, GLsizei count, GLenum type, size_t offset);
+    void beginGPUZone(const char *name);
+    void endGPUZone();
+
+    // Appends one whole command, header included
+    void appendCommand(const unsigned char *command);
+
+    // Rewrite the values of the uniforms already recorded at location, so that a recorded
+    // buffer can follow a change without being recorded again
+    void premultiplyUniforms(GLint location, const glm::mat4 &matrix);
+    void replaceUniforms(GLint location, const glm::vec3 &value);
+
+  private:
+    template <class Command>
+    void push(CommandType type, const Command &command, const void *extra = nullptr, size_t extraSize = 0);
+    void pushUniform(GLint location, UniformType type, const void *value, size_t valueSize);
+
+    std::vector<unsigned char> bytes;
+};
+
+struct CommandBufferStats {
+    unsigned int commands = 0;
+    unsigned int drawCalls = 0;
+    unsigned int triangles = 0;
+    // Commands left out by mergeCommandBuffers
+    unsigned int removed = 0;
+};
+
+// Concatenates buffers into output, leaving out commands that would set state that
+// the preceding commands have already set: rebinding the bound program, textures, VAO
+// or uniform buffer range, and setting a uniform to the value it already has. Nothing
+// is assumed about the GL state before the first command.
+CommandBufferStats mergeCommandBuffers(const CommandBuffer *const *buffers, size_t count, CommandBuffer &output);
+
+// Replays the commands on the current GL context, through state so that commands that
+// would not change the state are left out. GPU zones are measured with profiler, and
+// ignored if it is nullptr.
+CommandBufferStats executeCommandBuffer(const CommandBuffer &buffer, GLStateCache &state, GPUProfiler *profiler);
@@ -0,0 +1,113 @@
+#include "fileWatcher.h"
+#include <algorithm>
+#include <cstdio>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher() {
+    inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyDescriptor < 0) {
+        fprintf(stderr, "Could not start watching files: %s\n", strerror(errno));
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    if (inotifyDescriptor >= 0) {
+        close(inotifyDescriptor);
+    }
+}
+
+void FileWatcher::watch(const std::string &fileName) {
+    if (inotifyDescriptor < 0) {
+        return;
+    }
+    size_t slash = fileName.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : fileName.substr(0, slash);
+
+    // Editors either write the file in place or write a new file and rename it over the old one
+    int watchDescriptor = inotify_add_watch(inotifyDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watchDescriptor < 0) {
+        fprintf(stderr, "Could not watch %s: %s\n", directory.c_str(), strerror(errno));
+        return;
+    }
+    // Watching the same directory again returns the same descriptor
+    auto watched = std::find_if(directories.begin(), directories.end(),
+                                [watchDescriptor](const std::pair<int, std::string> &entry) {
+                                    return entry.first == watchDescriptor;
+                                });
+    if (watched == directories.end()) {
+        directories.emplace_back(watchDescriptor, directory);
+    }
+    files.push_back(fileName);
+}
+
+void FileWatcher::poll(std::vector<std::string> &changed) {
+    if (inotifyDescriptor < 0) {
+        return;
+    }
+    size_t firstChanged = changed.size();
+    alignas(inotify_event) char events[4096];
+    ssize_t length;
+    while ((length = read(inotifyDescriptor, events, sizeof(events))) > 0) {
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event *event = reinterpret_cast<const inotify_event *>(events + offset);
+            offset += ssize_t(sizeof(inotify_event) + event->len);
+            if (event->len == 0) {
+                continue;
+            }
+            for (const std::pair<int, std::string> &directory : directories) {
+                if (directory.first != event->wd) {
+                    continue;
+                }
+                std::string fileName = directory.second == "." ? event->name : directory.second + "/" + event->name;
+                bool isWatched = std::find(files.begin(), files.end(), fileName) != files.end();
+                // One save can produce several events
+                if (isWatched && std::find(changed.begin() + firstChanged, changed.end(), fileName) == changed.end()) {
+                    changed.push_back(fileName);
+                }
+            }
+        }
+    }
+}
+
+#else
+
+// Modification time of the file, or -1 if it does not exist
+static long long modifiedTime(const std::string &fileName) {
+    struct stat status;
+    if (stat(fileName.c_str(), &status) != 0) {
+        return -1;
+    }
+    return static_cast<long long>(status.st_mtime);
+}
+
+FileWatcher::FileWatcher() {}
+
+FileWatcher::~FileWatcher() {}
+
+void FileWatcher::watch(const std::string &fileName) {
+    files.push_back(fileName);
+    modifiedTimes.push_back(modifiedTime(fileName));
+}
+
+void FileWatcher::poll(std::vector<std::string> &changed) {
+    for (size_t i = 0; i < files.size(); i++) {
+        long long time = modifiedTime(files[i]);
+        // A missing file is being replaced, and is reported when it is back
+        if (time != modifiedTimes[i] && time != -1) {
+            modifiedTimes[i] = time;
+            changed.push_back(files[i]);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Reports files that were written. On Linux the directories of the files are watched with
+// inotify, which only reports files once they are closed after writing or renamed into
+// place, so a file is never seen half written. Elsewhere the modification times of the
+// files are compared on every poll.
+class FileWatcher {
+  public:
+    FileWatcher();
+    ~FileWatcher();
+
+    void watch(const std::string &fileName);
+    // Never blocks. Appends the watched files that changed since the last call, each once.
+    void poll(std::vector<std::string> &changed);
+
+    FileWatcher(FileWatcher const &) = delete;
+    FileWatcher &operator=(FileWatcher const &) = delete;
+
+  private:
+    std::vector<std::string> files;
+#ifdef __linux__
+    int inotifyDescriptor = -1;
+    // Watch descriptors and the directories they watch
+    std::vector<std::pair<int, std::string>> directories;
+#else
+    std::vector<long long> modifiedTimes;
+#endif
+};
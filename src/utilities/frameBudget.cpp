@@ -0,0 +1,35 @@
+#include "frameBudget.h"
+#include <algorithm>
+
+static double millisecondsBetween(std::chrono::steady_clock::time_point start,
+                                  std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void StepCost::add(double sample) {
+    milliseconds = std::max(sample, milliseconds + (sample - milliseconds) / 4);
+}
+
+void FrameBudget::beginFrame() {
+    frameStart = Clock::now();
+    tookStep = false;
+}
+
+bool FrameBudget::beginStep(StepCost &cost) {
+    stepStart = Clock::now();
+    if (tookStep && millisecondsBetween(frameStart, stepStart) + cost.milliseconds > budgetMs) {
+        return false;
+    }
+    step = &cost;
+    tookStep = true;
+    return true;
+}
+
+void FrameBudget::endStep() {
+    step->add(millisecondsBetween(stepStart, Clock::now()));
+    step = nullptr;
+}
+
+double FrameBudget::elapsedMilliseconds() const {
+    return millisecondsBetween(frameStart, Clock::now());
+}
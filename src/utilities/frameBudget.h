@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+
+// How long one kind of step takes, learned from the steps taken so far. A slower step
+// raises the estimate at once; faster ones lower it a quarter of the way at a time, so
+// that one quick step after a slow one does not let the next slow one overrun.
+struct StepCost {
+    double milliseconds = 0;
+
+    void add(double sample);
+};
+
+// Splits work that has to happen on one thread, such as GL uploads, into steps, and only
+// starts a step when its estimated cost fits in what is left of the frame's budget. The
+// first step of a frame is always taken, so that work still progresses when a single
+// step costs more than the whole budget.
+//
+//     budget.beginFrame();
+//     while (haveWork && budget.beginStep(cost)) {
+//         doStep();
+//         budget.endStep();
+//     }
+class FrameBudget {
+  public:
+    explicit FrameBudget(double milliseconds) : budgetMs(milliseconds) {}
+
+    void beginFrame();
+    // Returns whether a step of this kind fits. If it does, it has to be followed by
+    // endStep once the step is done, which adds its time to cost.
+    bool beginStep(StepCost &cost);
+    void endStep();
+
+    double elapsedMilliseconds() const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    double budgetMs;
+    Clock::time_point frameStart;
+    Clock::time_point stepStart;
+    StepCost *step = nullptr;
+    bool tookStep = false;
+};
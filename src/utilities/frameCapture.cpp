@@ -0,0 +1,173 @@
+#include "frameCapture.h"
+#include "imageWriter.h"
+#include "profiler.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+FrameCapture::FrameCapture(const std::string &directory, unsigned int width, unsigned int height,
+                           unsigned int presentWidth, unsigned int presentHeight, CaptureFormat format, int samples)
+    : directory(directory), width(width), height(height), presentWidth(presentWidth), presentHeight(presentHeight),
+      format(format), encoders(0, "capture encoder") {
+#ifdef _WIN32
+    _mkdir(directory.c_str());
+#else
+    mkdir(directory.c_str(), 0755);
+#endif
+
+    glCreateRenderbuffers(1, &colorBuffer);
+    glNamedRenderbufferStorageMultisample(colorBuffer, samples, GL_RGBA8, width, height);
+    glCreateRenderbuffers(1, &depthBuffer);
+    glNamedRenderbufferStorageMultisample(depthBuffer, samples, GL_DEPTH_COMPONENT24, width, height);
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+    glCreateRenderbuffers(1, &resolveColorBuffer);
+    glNamedRenderbufferStorage(resolveColorBuffer, GL_RGBA8, width, height);
+    glCreateFramebuffers(1, &resolveFramebuffer);
+    glNamedFramebufferRenderbuffer(resolveFramebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolveColorBuffer);
+
+    if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE ||
+        glCheckNamedFramebufferStatus(resolveFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Could not create the capture framebuffers\n");
+    }
+
+    const GLsizeiptr frameSize = GLsizeiptr(width) * height * 4;
+    for (Readback &readback : readbacks) {
+        glCreateBuffers(1, &readback.buffer);
+        glNamedBufferStorage(readback.buffer, frameSize, nullptr, GL_MAP_READ_BIT);
+    }
+    for (std::vector<unsigned char> &pixels : pixelBuffers) {
+        pixels.resize(frameSize);
+        freePixelBuffers.push_back(&pixels);
+    }
+}
+
+FrameCapture::~FrameCapture() {
+    for (Readback &readback : readbacks) {
+        if (readback.fence != nullptr) {
+            glDeleteSync(readback.fence);
+        }
+        glDeleteBuffers(1, &readback.buffer);
+    }
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteFramebuffers(1, &resolveFramebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteRenderbuffers(1, &resolveColorBuffer);
+}
+
+void FrameCapture::finish() {
+    // Oldest first, and waiting for the encoders whenever they are full, so that none are dropped
+    for (unsigned int i = 0; i < CAPTURE_READBACK_FRAMES; i++) {
+        Readback &readback = readbacks[(frameNumber + i) % CAPTURE_READBACK_FRAMES];
+        encoders.wait();
+        collect(readback, true);
+    }
+    encoders.wait();
+}
+
+void FrameCapture::beginFrame() {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void FrameCapture::endFrame(bool present) {
+    PROFILE_ZONE("FrameCapture::endFrame");
+
+    // Hand over whichever earlier frames the GPU has finished with
+    for (Readback &readback : readbacks) {
+        collect(readback, false);
+    }
+
+    glBlitNamedFramebuffer(framebuffer, resolveFramebuffer, 0, 0, width, height, 0, 0, width, height,
+                           GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    // Normally collected above; only waits when the GPU is CAPTURE_READBACK_FRAMES behind
+    Readback &readback = readbacks[frameNumber % CAPTURE_READBACK_FRAMES];
+    collect(readback, true);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolveFramebuffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.frameNumber = frameNumber++;
+
+    if (present) {
+        GLenum filter = presentWidth == width && presentHeight == height ? GL_NEAREST : GL_LINEAR;
+        glBlitNamedFramebuffer(resolveFramebuffer, 0, 0, 0, width, height, 0, 0, presentWidth, presentHeight,
+                               GL_COLOR_BUFFER_BIT, filter);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void FrameCapture::collect(Readback &readback, bool wait) {
+    if (readback.fence == nullptr) {
+        return;
+    }
+    GLenum status = glClientWaitSync(readback.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+    while (wait && status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return;
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    std::vector<unsigned char> *pixels = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(freePixelBuffersMutex);
+        if (!freePixelBuffers.empty()) {
+            pixels = freePixelBuffers.back();
+            freePixelBuffers.pop_back();
+        }
+    }
+    if (pixels == nullptr) {
+        // The encoders are CAPTURE_MAX_QUEUED_FRAMES frames behind
+        droppedFrames++;
+        return;
+    }
+
+    PROFILE_ZONE("FrameCapture::collect");
+    const size_t rowSize = size_t(width) * 4;
+    const unsigned char *mapped = static_cast<const unsigned char *>(
+        glMapNamedBufferRange(readback.buffer, 0, rowSize * height, GL_MAP_READ_BIT));
+    // GL stores the bottom row first; images start at the top
+    for (unsigned int row = 0; row < height; row++) {
+        std::memcpy(pixels->data() + rowSize * row, mapped + rowSize * (height - 1 - row), rowSize);
+    }
+    glUnmapNamedBuffer(readback.buffer);
+
+    unsigned int number = readback.frameNumber;
+    encoders.submit([this, number, pixels] { encode(number, pixels); });
+    savedFrames++;
+}
+
+void FrameCapture::encode(unsigned int number, std::vector<unsigned char> *pixels) {
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "/frame%06u.%s", number, format == CaptureFormat::QOI ? "qoi" : "png");
+    if (format == CaptureFormat::QOI) {
+        writeQOIFile(directory + fileName, pixels->data(), width, height);
+    } else {
+        writePNGFile(directory + fileName, pixels->data(), width, height);
+    }
+
+    std::lock_guard<std::mutex> lock(freePixelBuffersMutex);
+    freePixelBuffers.push_back(pixels);
+}
+
+void FrameCapture::printStats() const {
+    printf("Captured %u frames to %s", savedFrames, directory.c_str());
+    if (droppedFrames > 0) {
+        printf(", dropped %u because encoding fell behind", droppedFrames);
+    }
+    printf("\n");
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "threadPool.h"
+#include <glad/glad.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Pixel buffers being read back into. A frame is mapped CAPTURE_READBACK_FRAMES - 1
+// frames after it was drawn, by which time the GPU has normally finished copying it.
+#define CAPTURE_READBACK_FRAMES 3
+// Frames read back but not yet encoded. Frames beyond this are dropped rather than
+// slowing the game down.
+#define CAPTURE_MAX_QUEUED_FRAMES 8
+
+enum class CaptureFormat { QOI, PNG };
+
+// Renders into an offscreen framebuffer of the capture size, which need not be the
+// window's, and saves every frame as a numbered image.
+// Frames are copied into a ring of pixel buffer objects with glReadPixels, and only
+// mapped once their fence has signalled, so the GL thread does not wait for the GPU.
+// The mapped pixels are copied out and encoded on a thread pool.
+class FrameCapture {
+  public:
+    // Frames are presented by scaling them to presentWidth x presentHeight
+    FrameCapture(const std::string &directory, unsigned int width, unsigned int height, unsigned int presentWidth,
+                 unsigned int presentHeight, CaptureFormat format, int samples);
+    ~FrameCapture();
+
+    // Binds the offscreen framebuffer as the target of the frame's draws
+    void beginFrame();
+    // Starts reading the frame back, and copies it to the window unless present is false
+    void endFrame(bool present);
+
+    // Saves the frames still in flight, and waits until every frame has been written
+    void finish();
+    void printStats() const;
+
+    FrameCapture(FrameCapture const &) = delete;
+    FrameCapture &operator=(FrameCapture const &) = delete;
+
+  private:
+    struct Readback {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        unsigned int frameNumber = 0;
+    };
+
+    // Maps a finished readback and queues it for encoding. Waits for the GPU if wait is true.
+    void collect(Readback &readback, bool wait);
+    void encode(unsigned int frameNumber, std::vector<unsigned char> *pixels);
+
+    std::string directory;
+    unsigned int width;
+    unsigned int height;
+    unsigned int presentWidth;
+    unsigned int presentHeight;
+    CaptureFormat format;
+
+    // Multisampled target, resolved into a single sampled one for reading back
+    GLuint framebuffer = 0;
+    GLuint colorBuffer = 0;
+    GLuint depthBuffer = 0;
+    GLuint resolveFramebuffer = 0;
+    GLuint resolveColorBuffer = 0;
+
+    Readback readbacks[CAPTURE_READBACK_FRAMES];
+    unsigned int frameNumber = 0;
+
+    std::vector<unsigned char> pixelBuffers[CAPTURE_MAX_QUEUED_FRAMES];
+    // Shared with the encoding threads
+    std::vector<std::vector<unsigned char> *> freePixelBuffers;
+    std::mutex freePixelBuffersMutex;
+
+    unsigned int savedFrames = 0;
+    unsigned int droppedFrames = 0;
+
+    // Declared last, so it finishes its tasks before the buffers they use are destroyed
+    ThreadPool encoders;
+};
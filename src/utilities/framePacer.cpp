@@ -0,0 +1,83 @@
+#include "framePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+void RunningStats::add(double sample) {
+    count++;
+    double delta = sample - mean;
+    mean += delta / count;
+    sumOfSquares += delta * (sample - mean);
+    min = count == 1 ? sample : std::min(min, sample);
+    max = count == 1 ? sample : std::max(max, sample);
+}
+
+double RunningStats::standardDeviation() const {
+    return std::sqrt(variance());
+}
+
+FramePacer::FramePacer(double maxFps, bool vsync, double refreshRate) {
+    period = maxFps > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / maxFps))
+                        : Clock::duration::zero();
+    if (maxFps > 0) {
+        targetFrameSeconds = 1.0 / (vsync && refreshRate > 0 ? std::min(maxFps, refreshRate) : maxFps);
+    } else {
+        targetFrameSeconds = vsync && refreshRate > 0 ? 1.0 / refreshRate : 0;
+    }
+}
+
+void FramePacer::sleepUntil(Clock::time_point deadline) {
+    // How long a 1 ms sleep is assumed to take until it has been measured
+    const double defaultEstimate = 0.002;
+
+    while (true) {
+        Clock::time_point sleepStart = Clock::now();
+        double remaining = std::chrono::duration<double>(deadline - sleepStart).count();
+        double estimate = sleepTimes.count > 1 ? sleepTimes.mean + sleepTimes.standardDeviation() : defaultEstimate;
+        if (remaining <= estimate) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        sleepTimes.add(std::chrono::duration<double>(Clock::now() - sleepStart).count());
+    }
+
+    // Spin for the rest
+    while (Clock::now() < deadline) {
+    }
+}
+
+void FramePacer::waitForNextFrame() {
+    if (period != Clock::duration::zero()) {
+        if (!started) {
+            deadline = Clock::now();
+        }
+        deadline += period;
+        sleepUntil(deadline);
+        // After a late frame, pace from now on rather than rushing the following frames to catch up
+        deadline = std::max(deadline, Clock::now());
+    }
+
+    Clock::time_point now = Clock::now();
+    if (started) {
+        double frameSeconds = std::chrono::duration<double>(now - previousFrame).count();
+        frameTimes.add(frameSeconds * 1000.0);
+        if (targetFrameSeconds > 0 && frameSeconds > targetFrameSeconds * (1 + FRAME_PACER_LATE_TOLERANCE)) {
+            lateFrames++;
+        }
+    }
+    previousFrame = now;
+    started = true;
+}
+
+void FramePacer::printStats() const {
+    if (frameTimes.count == 0) {
+        return;
+    }
+    printf("Frame time: mean %.3f ms, standard deviation %.3f ms, min %.3f ms, max %.3f ms\n", frameTimes.mean,
+           frameTimes.standardDeviation(), frameTimes.min, frameTimes.max);
+    if (targetFrameSeconds > 0) {
+        printf("Late frames: %zu of %zu (%.2f%%)\n", lateFrames, frameTimes.count,
+               100.0 * lateFrames / frameTimes.count);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// A frame counts as late when it takes this much longer than the target frame time
+#define FRAME_PACER_LATE_TOLERANCE 0.1
+
+// Mean and variance of a series of samples, updated one sample at a time (Welford's method)
+struct RunningStats {
+    size_t count = 0;
+    double mean = 0;
+    double sumOfSquares = 0;
+    double min = 0;
+    double max = 0;
+
+    void add(double sample);
+    double variance() const { return count > 1 ? sumOfSquares / (count - 1) : 0; }
+    double standardDeviation() const;
+};
+
+// Limits the frame rate to a steady-clock deadline. Most of the wait is spent sleeping,
+// and the last stretch spinning: the limiter keeps track of how much sleeps overshoot,
+// and stops sleeping once the time left is shorter than a typical overshoot.
+class FramePacer {
+  public:
+    // maxFps of 0 does not limit the frame rate. refreshRate is only used to detect late
+    // frames when vsync is on and there is no limit.
+    FramePacer(double maxFps, bool vsync, double refreshRate);
+
+    // Waits until the next frame is due, and records the time since the previous frame
+    void waitForNextFrame();
+
+    const RunningStats &frameTimeStats() const { return frameTimes; }
+    size_t lateFrameCount() const { return lateFrames; }
+    void printStats() const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    void sleepUntil(Clock::time_point deadline);
+
+    Clock::duration period;
+    // 0 if there is no target to be late for
+    double targetFrameSeconds;
+
+    Clock::time_point deadline;
+    Clock::time_point previousFrame;
+    bool started = false;
+
+    RunningStats frameTimes;
+    RunningStats sleepTimes;
+    size_t lateFrames = 0;
+};
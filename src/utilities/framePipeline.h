@@ -0,0 +1,67 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#define FRAME_PIPELINE_SLOTS 3
+
+// Hands frames from a producer thread to a consumer thread in order, through a fixed set
+// of reusable slots. The producer may run up to maxFramesAhead frames ahead of the frame
+// being consumed. With 0, every frame is consumed before the next one is produced, so
+// both sides can run one after the other on a single thread.
+template <class T> class FramePipeline {
+  public:
+    explicit FramePipeline(unsigned int maxFramesAhead)
+        : maxFramesAhead(std::min(maxFramesAhead, unsigned(FRAME_PIPELINE_SLOTS - 1))) {}
+
+    // Waits for a free slot. Returns nullptr once the pipeline has been closed.
+    T *beginWrite() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return closed || written - released <= maxFramesAhead; });
+        return closed ? nullptr : &slots[written % FRAME_PIPELINE_SLOTS];
+    }
+
+    void endWrite() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written++;
+        }
+        changed.notify_all();
+    }
+
+    // Waits for the next frame. Returns nullptr once the pipeline has been closed.
+    T *beginRead() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return closed || written > released; });
+        return closed ? nullptr : &slots[released % FRAME_PIPELINE_SLOTS];
+    }
+
+    void endRead() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            released++;
+        }
+        changed.notify_all();
+    }
+
+    // Wakes up and stops both sides
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        changed.notify_all();
+    }
+
+  private:
+    T slots[FRAME_PIPELINE_SLOTS];
+    const unsigned int maxFramesAhead;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint64_t written = 0;
+    uint64_t released = 0;
+    bool closed = false;
+};
@@ -0,0 +1,177 @@
+#include "geometryCache.h"
+#include "glutils.h"
+#include "mappedFile.h"
+#include "profiler.h"
+#include "vertexFormat.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Relative to the working directory, like the paths to the resources
+#define GEOMETRY_CACHE_DIRECTORY "geometry-cache"
+
+// Set by the build from the sources of the mesh generators and of bakeMesh
+#ifndef GEOMETRY_SOURCE_HASH
+#define GEOMETRY_SOURCE_HASH "unknown"
+#endif
+
+// Cache files are laid out as: header, key, padding up to a multiple of 16 bytes,
+// vertex data, index data. The data is stored exactly as it is given to glBufferData.
+struct BakedGeometryHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t vertexStride;
+    uint32_t indexType;
+    uint32_t indexCount;
+    uint32_t keyLength;
+    uint64_t vertexBytes;
+    uint64_t indexBytes;
+};
+
+static const char bakedGeometryMagic[4] = {'G', 'B', 'A', 'K'};
+
+void appendKeyParameter(std::string &key, float value) {
+    // Hexadecimal floats are exact
+    char text[32];
+    snprintf(text, sizeof(text), " %a", double(value));
+    key += text;
+}
+
+void appendKeyParameter(std::string &key, int value) {
+    key += " " + std::to_string(value);
+}
+
+void appendKeyParameter(std::string &key, bool value) {
+    key += value ? " true" : " false";
+}
+
+void appendKeyParameter(std::string &key, const glm::vec2 &value) {
+    appendKeyParameters(key, value.x, value.y);
+}
+
+void appendKeyParameter(std::string &key, const glm::vec3 &value) {
+    appendKeyParameters(key, value.x, value.y, value.z);
+}
+
+static size_t dataOffset(size_t keyLength) {
+    return (sizeof(BakedGeometryHeader) + keyLength + 15) / 16 * 16;
+}
+
+static std::string cacheFileName(const std::string &key) {
+    // FNV-1a, the full key is stored in the file to rule out collisions
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), GEOMETRY_CACHE_DIRECTORY "/%016llx.bin", static_cast<unsigned long long>(hash));
+    return name;
+}
+
+static bool loadFromCache(const std::string &fileName, const std::string &key, CachedBuffer &buffer) {
+    MappedFile file(fileName);
+    if (!file.isOpen() || file.size() < sizeof(BakedGeometryHeader)) {
+        return false;
+    }
+
+    BakedGeometryHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, bakedGeometryMagic, sizeof(header.magic)) != 0 ||
+        header.version != GEOMETRY_CACHE_VERSION || header.vertexStride != sizeof(PackedVertex) ||
+        header.keyLength != key.size() ||
+        file.size() < dataOffset(header.keyLength) + header.vertexBytes + header.indexBytes ||
+        std::memcmp(file.data() + sizeof(header), key.data(), key.size()) != 0) {
+        return false;
+    }
+    // A file that passes the checks above but is inconsistent would make the draws read
+    // past the end of the buffers
+    uint64_t indexSize = header.indexType == GL_UNSIGNED_SHORT ? 2 : header.indexType == GL_UNSIGNED_INT ? 4 : 0;
+    if (indexSize == 0 || header.indexBytes != header.indexCount * indexSize ||
+        header.vertexBytes % sizeof(PackedVertex) != 0) {
+        fprintf(stderr, "Ignoring the inconsistent geometry cache file \"%s\".\n", fileName.c_str());
+        return false;
+    }
+
+    const char *vertexData = file.data() + dataOffset(header.keyLength);
+    const char *indexData = vertexData + header.vertexBytes;
+    buffer.vertexArrayObjectID = uploadMesh(vertexData, header.vertexBytes, indexData, header.indexBytes);
+    buffer.indexCount = header.indexCount;
+    buffer.indexType = header.indexType;
+    return true;
+}
+
+static void writeToCache(const std::string &fileName, const std::string &key, const BakedMesh &baked) {
+#ifdef _WIN32
+    _mkdir(GEOMETRY_CACHE_DIRECTORY);
+#else
+    mkdir(GEOMETRY_CACHE_DIRECTORY, 0755);
+#endif
+
+    BakedGeometryHeader header;
+    std::memcpy(header.magic, bakedGeometryMagic, sizeof(header.magic));
+    header.version = GEOMETRY_CACHE_VERSION;
+    header.vertexStride = sizeof(PackedVertex);
+    header.indexType = baked.indexType;
+    header.indexCount = baked.indexCount;
+    header.keyLength = key.size();
+    header.vertexBytes = baked.vertexData.size();
+    header.indexBytes = baked.indexData.size();
+
+    // Write to a temporary file first, so an interrupted write never leaves a broken cache file behind
+    std::string temporaryName = fileName + ".tmp";
+    std::ofstream file(temporaryName, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        fprintf(stderr, "Could not write geometry cache file \"%s\".\n", temporaryName.c_str());
+        return;
+    }
+    const char padding[16] = {0};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(key.data(), key.size());
+    file.write(padding, dataOffset(key.size()) - sizeof(header) - key.size());
+    file.write(reinterpret_cast<const char *>(baked.vertexData.data()), baked.vertexData.size());
+    file.write(reinterpret_cast<const char *>(baked.indexData.data()), baked.indexData.size());
+    file.close();
+    if (!file) {
+        // Probably out of disk space; the next run bakes the mesh again
+        fprintf(stderr, "Could not write geometry cache file \"%s\".\n", temporaryName.c_str());
+        std::remove(temporaryName.c_str());
+        return;
+    }
+
+    std::remove(fileName.c_str());
+    if (std::rename(temporaryName.c_str(), fileName.c_str()) != 0) {
+        fprintf(stderr, "Could not rename \"%s\" to \"%s\".\n", temporaryName.c_str(), fileName.c_str());
+        std::remove(temporaryName.c_str());
+    }
+}
+
+CachedBuffer loadCachedBuffer(const std::string &key, const std::function<Mesh()> &generate) {
+    PROFILE_ZONE("loadCachedBuffer");
+
+    // Meshes baked by other versions of the generators get other files
+    std::string fullKey = key + " source " GEOMETRY_SOURCE_HASH;
+    std::string fileName = cacheFileName(fullKey);
+
+    CachedBuffer buffer;
+    if (loadFromCache(fileName, fullKey, buffer)) {
+        return buffer;
+    }
+
+    Mesh mesh = generate();
+    BakedMesh baked = bakeMesh(mesh);
+    writeToCache(fileName, fullKey, baked);
+
+    buffer.vertexArrayObjectID = uploadMesh(baked.vertexData.data(), baked.vertexData.size(),
+                                            baked.indexData.data(), baked.indexData.size());
+    buffer.indexCount = baked.indexCount;
+    buffer.indexType = baked.indexType;
+    return buffer;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "mesh.h"
+#include <functional>
+#include <glm/glm.hpp>
+#include <string>
+
+// Version of the cache file layout. Changes to the code that makes the meshes do not need
+// a bump: the build hashes those sources into GEOMETRY_SOURCE_HASH, which is part of every key.
+#define GEOMETRY_CACHE_VERSION 2
+
+struct CachedBuffer {
+    unsigned int vertexArrayObjectID;
+    unsigned int indexCount;
+    unsigned int indexType;
+};
+
+void appendKeyParameter(std::string &key, float value);
+void appendKeyParameter(std::string &key, int value);
+void appendKeyParameter(std::string &key, bool value);
+void appendKeyParameter(std::string &key, const glm::vec2 &value);
+void appendKeyParameter(std::string &key, const glm::vec3 &value);
+
+inline void appendKeyParameters(std::string &) {}
+
+template <class Parameter, class... Parameters>
+void appendKeyParameters(std::string &key, const Parameter &parameter, const Parameters &... parameters) {
+    appendKeyParameter(key, parameter);
+    appendKeyParameters(key, parameters...);
+}
+
+// Makes a key for loadCachedBuffer out of the generator's name and every parameter it
+// is called with, defaults included. Floats are written exactly, so that any change to
+// a parameter gives a different key.
+template <class... Parameters> std::string geometryKey(const char *generator, const Parameters &... parameters) {
+    std::string key = generator;
+    appendKeyParameters(key, parameters...);
+    return key;
+}
+
+// Returns a VAO for the mesh made by generate. The key names the generator and all of
+// its parameters, see geometryKey. The first time a key is seen the mesh is baked (see bakeMesh) and
+// written to the cache directory; after that the cache file is memory-mapped and
+// uploaded as is, without running the generator or touching individual vertices.
+CachedBuffer loadCachedBuffer(const std::string &key, const std::function<Mesh()> &generate);
@@ -0,0 +1,150 @@
+#include "glStateCache.h"
+#include <algorithm>
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+void GLStateCache::useProgram(GLuint newProgram) {
+    if (programKnown && program == newProgram) {
+        frameCounters.skipped++;
+        return;
+    }
+    glUseProgram(newProgram);
+    frameCounters.issued++;
+    programKnown = true;
+    program = newProgram;
+
+    auto found = std::find_if(programUniforms.begin(), programUniforms.end(),
+                              [newProgram](const ProgramUniforms &entry) { return entry.program == newProgram; });
+    if (found == programUniforms.end()) {
+        programUniforms.emplace_back();
+        programUniforms.back().program = newProgram;
+        found = programUniforms.end() - 1;
+    }
+    uniforms = int(found - programUniforms.begin());
+}
+
+void GLStateCache::bindVertexArray(GLuint newVertexArray) {
+    if (vertexArrayKnown && vertexArray == newVertexArray) {
+        frameCounters.skipped++;
+        return;
+    }
+    glBindVertexArray(newVertexArray);
+    frameCounters.issued++;
+    vertexArrayKnown = true;
+    vertexArray = newVertexArray;
+}
+
+void GLStateCache::bindTextures(GLuint first, GLsizei count, const GLuint *newTextures) {
+    // Bound with a single call, unless every unit already has its texture
+    bool changed = first + GLuint(count) > GL_STATE_TEXTURE_UNITS;
+    for (GLuint unit = first; unit < first + GLuint(count) && !changed; unit++) {
+        changed = !texturesKnown[unit] || textures[unit] != newTextures[unit - first];
+    }
+    if (!changed) {
+        frameCounters.skipped++;
+        return;
+    }
+    glBindTextures(first, count, newTextures);
+    frameCounters.issued++;
+    for (GLuint unit = first; unit < std::min<GLuint>(first + GLuint(count), GL_STATE_TEXTURE_UNITS); unit++) {
+        texturesKnown[unit] = true;
+        textures[unit] = newTextures[unit - first];
+    }
+}
+
+void GLStateCache::bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    if (index < GL_STATE_UNIFORM_BUFFERS) {
+        BufferRange &range = uniformBuffers[index];
+        if (uniformBuffersKnown[index] && range.buffer == buffer && range.offset == offset && range.size == size) {
+            frameCounters.skipped++;
+            return;
+        }
+        uniformBuffersKnown[index] = true;
+        range = {buffer, offset, size};
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+    frameCounters.issued++;
+}
+
+void GLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    GLint rect[4] = {x, y, width, height};
+    if (viewportKnown && std::equal(rect, rect + 4, viewportRect)) {
+        frameCounters.skipped++;
+        return;
+    }
+    glViewport(x, y, width, height);
+    frameCounters.issued++;
+    viewportKnown = true;
+    std::copy(rect, rect + 4, viewportRect);
+}
+
+bool GLStateCache::changeUniform(GLint location, const void *value, GLsizei size) {
+    if (uniforms < 0 || location < 0 || location >= GL_STATE_TRACKED_UNIFORMS) {
+        return true;
+    }
+    UniformValue &current = programUniforms[uniforms].values[location];
+    if (current.known && current.size == size && std::memcmp(current.words, value, size) == 0) {
+        frameCounters.skipped++;
+        return false;
+    }
+    current.known = true;
+    current.size = size;
+    std::memcpy(current.words, value, size);
+    return true;
+}
+
+void GLStateCache::uniform(GLint location, GLuint value) {
+    if (changeUniform(location, &value, sizeof(value))) {
+        glUniform1ui(location, value);
+        frameCounters.issued++;
+    }
+}
+
+void GLStateCache::uniform(GLint location, const glm::vec3 &value) {
+    if (changeUniform(location, glm::value_ptr(value), sizeof(value))) {
+        glUniform3fv(location, 1, glm::value_ptr(value));
+        frameCounters.issued++;
+    }
+}
+
+void GLStateCache::uniform(GLint location, const glm::vec4 &value) {
+    if (changeUniform(location, glm::value_ptr(value), sizeof(value))) {
+        glUniform4fv(location, 1, glm::value_ptr(value));
+        frameCounters.issued++;
+    }
+}
+
+void GLStateCache::uniform(GLint location, const glm::uvec4 &value) {
+    if (changeUniform(location, &value.x, sizeof(value))) {
+        glUniform4uiv(location, 1, &value.x);
+        frameCounters.issued++;
+    }
+}
+
+void GLStateCache::uniform(GLint location, const glm::mat3 &value) {
+    glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    frameCounters.issued++;
+}
+
+void GLStateCache::uniform(GLint location, const glm::mat4 &value) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    frameCounters.issued++;
+}
+
+void GLStateCache::invalidate() {
+    programKnown = false;
+    uniforms = -1;
+    vertexArrayKnown = false;
+    std::fill(texturesKnown, texturesKnown + GL_STATE_TEXTURE_UNITS, false);
+    std::fill(uniformBuffersKnown, uniformBuffersKnown + GL_STATE_UNIFORM_BUFFERS, false);
+    viewportKnown = false;
+}
+
+void GLStateCache::forgetProgram(GLuint forgotten) {
+    for (ProgramUniforms &entry : programUniforms) {
+        if (entry.program == forgotten) {
+            entry = ProgramUniforms();
+            entry.program = forgotten;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Texture units and uniform buffer binding points whose bindings are tracked
+#define GL_STATE_TEXTURE_UNITS 16
+#define GL_STATE_UNIFORM_BUFFERS 8
+// Uniform locations below this have their values tracked, per program
+#define GL_STATE_TRACKED_UNIFORMS 32
+
+struct GLStateCounters {
+    // Calls passed on to GL, and calls left out because they would not change anything
+    unsigned int issued = 0;
+    unsigned int skipped = 0;
+};
+
+// Remembers the state set through it, and leaves out calls that set the state to what it
+// already is: binding the bound program, VAO, textures or uniform buffer range, setting
+// the viewport it already has, and setting a scalar or vector uniform of the bound
+// program to its current value. Matrix uniforms are always set, as they rarely repeat.
+//
+// mergeCommandBuffers already removes most redundant commands within a frame; the cache
+// also catches the ones between frames and around commands issued outside of buffers.
+// Nothing is known about the state until it is first set through the cache. Only use
+// it on the thread with the GL context.
+class GLStateCache {
+  public:
+    // Resets the counters
+    void beginFrame() { frameCounters = GLStateCounters(); }
+    const GLStateCounters &counters() const { return frameCounters; }
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindTextures(GLuint first, GLsizei count, const GLuint *textures);
+    void bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // Set uniforms of the bound program
+    void uniform(GLint location, GLuint value);
+    void uniform(GLint location, const glm::vec3 &value);
+    void uniform(GLint location, const glm::vec4 &value);
+    void uniform(GLint location, const glm::uvec4 &value);
+    void uniform(GLint location, const glm::mat3 &value);
+    void uniform(GLint location, const glm::mat4 &value);
+
+    // Forgets the bindings and the viewport, after GL calls made around the cache may have
+    // changed them. Uniform values are kept, as they belong to the programs.
+    void invalidate();
+    // Forgets the uniform values of program, when it was relinked, its uniforms were set
+    // without the cache, or its name may be reused
+    void forgetProgram(GLuint program);
+
+  private:
+    struct UniformValue {
+        bool known = false;
+        GLsizei size = 0;
+        GLuint words[4];
+    };
+
+    struct ProgramUniforms {
+        GLuint program;
+        UniformValue values[GL_STATE_TRACKED_UNIFORMS];
+    };
+
+    struct BufferRange {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    // Returns false, counting a skipped call, if the uniform already has the value.
+    // Otherwise remembers it.
+    bool changeUniform(GLint location, const void *value, GLsizei size);
+
+    GLStateCounters frameCounters;
+
+    bool programKnown = false;
+    GLuint program = 0;
+    // Index of the bound program's uniform values in programUniforms, or -1 if no
+    // program is known
+    int uniforms = -1;
+    std::vector<ProgramUniforms> programUniforms;
+
+    bool vertexArrayKnown = false;
+    GLuint vertexArray = 0;
+    bool texturesKnown[GL_STATE_TEXTURE_UNITS] = {};
+    GLuint textures[GL_STATE_TEXTURE_UNITS] = {};
+    bool uniformBuffersKnown[GL_STATE_UNIFORM_BUFFERS] = {};
+    BufferRange uniformBuffers[GL_STATE_UNIFORM_BUFFERS] = {};
+    bool viewportKnown = false;
+    GLint viewportRect[4] = {};
+};
@@ -1,71 +1,87 @@
 #include <glad/glad.h>
 #include <program.hpp>
 #include "glutils.h"
+#include "meshOptimizer.h"
+#include "profiler.h"
+#include "tangents.h"
+#include "vertexFormat.h"
+#include <algorithm>
+#include <cstdio>
 #include <vector>
 
-template <class T>
-unsigned int generateAttribute(int id, int elementsPerEntry, std::vector<T> data, bool normalize) {
-    unsigned int bufferID;
-    glGenBuffers(1, &bufferID);
-    glBindBuffer(GL_ARRAY_BUFFER, bufferID);
-    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(T), data.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(id, elementsPerEntry, GL_FLOAT, normalize ? GL_TRUE : GL_FALSE, sizeof(T), 0);
-    glEnableVertexAttribArray(id);
-    return bufferID;
+unsigned int indexType(const Mesh &mesh) {
+    return mesh.vertices.size() <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 }
 
-unsigned int generateBuffer(Mesh &mesh) {
-    unsigned int vaoID;
-    glGenVertexArrays(1, &vaoID);
-    glBindVertexArray(vaoID);
+BakedMesh bakeMesh(Mesh &mesh) {
+    PROFILE_ZONE("bakeMesh");
 
-    generateAttribute(0, 3, mesh.vertices, false);
-    if (mesh.normals.size() > 0) {
-        generateAttribute(1, 3, mesh.normals, true);
-    }
-    if (mesh.textureCoordinates.size() > 0) {
-        generateAttribute(2, 2, mesh.textureCoordinates, false);
-    }
+    MeshOptimizationStats stats = optimizeMesh(mesh);
+#ifdef GLOWBOX_PROFILING
+    printf("Optimized mesh: %zu -> %zu vertices, ACMR %.3f -> %.3f\n", stats.verticesBefore, stats.verticesAfter,
+           stats.acmrBefore, stats.acmrAfter);
+#else
+    (void)stats;
+#endif
 
-    if (mesh.normals.size() > 0 && mesh.textureCoordinates.size() > 0) {
-        std::vector<glm::vec3> tangents;
-        std::vector<glm::vec3> bitangents;
+    bool hasNormals = mesh.normals.size() > 0;
+    bool hasTextureCoordinates = mesh.textureCoordinates.size() > 0;
 
-        for (size_t i = 0; i < mesh.vertices.size(); i += 3) {
-            glm::vec3 v0 = mesh.vertices[i];
-            glm::vec3 v1 = mesh.vertices[i + 1];
-            glm::vec3 v2 = mesh.vertices[i + 2];
+    // Meshes loaded from a cache may already have their tangents
+    if (mesh.tangents.empty() && hasNormals && hasTextureCoordinates) {
+        generateTangents(mesh);
+    }
 
-            glm::vec2 uv0 = mesh.textureCoordinates[i];
-            glm::vec2 uv1 = mesh.textureCoordinates[i + 1];
-            glm::vec2 uv2 = mesh.textureCoordinates[i + 2];
+    BakedMesh baked;
+    baked.vertexData.resize(mesh.vertices.size() * sizeof(PackedVertex));
+    PackedVertex *vertices = reinterpret_cast<PackedVertex *>(baked.vertexData.data());
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        PackedVertex &vertex = vertices[i];
+        vertex.position = mesh.vertices[i];
+        vertex.normal = packNormal(hasNormals ? glm::vec4(mesh.normals[i], 0) : glm::vec4(0));
+        vertex.tangent = packNormal(mesh.tangents.empty() ? glm::vec4(0) : mesh.tangents[i]);
+        vertex.textureCoordinates = packHalf(hasTextureCoordinates ? mesh.textureCoordinates[i] : glm::vec2(0));
+    }
 
-            glm::vec3 deltaPos1 = v1 - v0;
-            glm::vec3 deltaPos2 = v2 - v0;
+    baked.indexCount = mesh.indices.size();
+    baked.indexType = indexType(mesh);
+    if (baked.indexType == GL_UNSIGNED_SHORT) {
+        baked.indexData.resize(mesh.indices.size() * sizeof(unsigned short));
+        unsigned short *indices = reinterpret_cast<unsigned short *>(baked.indexData.data());
+        std::copy(mesh.indices.begin(), mesh.indices.end(), indices);
+    } else {
+        baked.indexData.resize(mesh.indices.size() * sizeof(unsigned int));
+        std::copy(mesh.indices.begin(), mesh.indices.end(), reinterpret_cast<unsigned int *>(baked.indexData.data()));
+    }
 
-            glm::vec2 deltaUv1 = uv1 - uv0;
-            glm::vec2 deltaUv2 = uv2 - uv0;
+    return baked;
+}
 
-            float r = 1.0f / (deltaUv1.x * deltaUv2.y - deltaUv1.y * deltaUv2.x);
-            glm::vec3 tangent = (deltaPos1 * deltaUv2.y - deltaPos2 * deltaUv1.y) * r;
-            glm::vec3 bitangent = (deltaPos2 * deltaUv1.x - deltaPos1 * deltaUv2.x) * r;
+unsigned int uploadMesh(const void *vertexData, size_t vertexBytes, const void *indexData, size_t indexBytes) {
+    PROFILE_ZONE("uploadMesh");
 
-            tangents.push_back(tangent);
-            tangents.push_back(tangent);
-            tangents.push_back(tangent);
-            bitangents.push_back(bitangent);
-            bitangents.push_back(bitangent);
-            bitangents.push_back(bitangent);
-        }
+    unsigned int vaoID;
+    glGenVertexArrays(1, &vaoID);
+    glBindVertexArray(vaoID);
 
-        generateAttribute(3, 3, tangents, false);
-        generateAttribute(4, 3, bitangents, false);
-    }
+    unsigned int vertexBufferID;
+    glGenBuffers(1, &vertexBufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, GL_STATIC_DRAW);
+    setupVertexAttributes<PackedVertex>();
 
     unsigned int indexBufferID;
     glGenBuffers(1, &indexBufferID);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData, GL_STATIC_DRAW);
 
     return vaoID;
 }
+
+unsigned int generateBuffer(Mesh &mesh) {
+    PROFILE_ZONE("generateBuffer");
+
+    BakedMesh baked = bakeMesh(mesh);
+    return uploadMesh(baked.vertexData.data(), baked.vertexData.size(), baked.indexData.data(),
+                      baked.indexData.size());
+}
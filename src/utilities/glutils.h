@@ -1,5 +1,23 @@
 #pragma once
 
 #include "mesh.h"
+#include <cstddef>
 
-unsigned int generateBuffer(Mesh &mesh);
\ No newline at end of file
+// A mesh in exactly the form generateBuffer uploads it in: interleaved PackedVertex
+// data and 16 or 32 bit indices
+struct BakedMesh {
+    std::vector<unsigned char> vertexData;
+    std::vector<unsigned char> indexData;
+    unsigned int indexCount;
+    unsigned int indexType;
+};
+
+unsigned int generateBuffer(Mesh &mesh);
+
+// The two halves of generateBuffer. bakeMesh does all of the CPU work (optimization,
+// tangents and packing), uploadMesh creates the VAO from the result.
+BakedMesh bakeMesh(Mesh &mesh);
+unsigned int uploadMesh(const void *vertexData, size_t vertexBytes, const void *indexData, size_t indexBytes);
+
+// The index type generateBuffer uploads the mesh's indices as (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)
+unsigned int indexType(const Mesh &mesh);
@@ -0,0 +1,93 @@
+#include "gpuProfiler.h"
+#include "profiler.h"
+#include <cstdio>
+
+static const unsigned int invalidZone = ~0u;
+
+GPUProfiler::GPUProfiler() {
+    for (Frame &frame : frames) {
+        glGenQueries(2 * GPU_PROFILER_MAX_ZONES, frame.queries);
+    }
+    track = profilerCreateTrack("GPU");
+}
+
+void GPUProfiler::readBack(Frame &frame) {
+    // Timestamps complete in order, so the last one being available means all of them are
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < frame.zoneCount; i++) {
+        glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &frame.zones[i].start);
+        glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &frame.zones[i].end);
+        profilerRecordOnTrack(track, frame.zones[i].name, frame.zones[i].start + frame.clockOffset,
+                              frame.zones[i].end + frame.clockOffset);
+    }
+    lastFrameMs = double(frame.zones[0].end - frame.zones[0].start) / 1e6;
+    frame.pending = false;
+}
+
+void GPUProfiler::beginFrame() {
+    // Read back finished frames, oldest first
+    for (unsigned int i = 1; i <= GPU_PROFILER_FRAMES; i++) {
+        Frame &frame = frames[(frameIndex + i) % GPU_PROFILER_FRAMES];
+        if (frame.pending) {
+            readBack(frame);
+        }
+    }
+
+    frameIndex = (frameIndex + 1) % GPU_PROFILER_FRAMES;
+    current = &frames[frameIndex];
+    if (current->pending) {
+        // The GPU is more than GPU_PROFILER_FRAMES frames behind; skip measuring this frame
+        current = nullptr;
+        return;
+    }
+
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    current->clockOffset = int64_t(profilerNow()) - gpuNow;
+    current->zoneCount = 0;
+    current->droppedZoneCount = 0;
+    beginZone("GPU frame");
+}
+
+void GPUProfiler::endFrame() {
+    if (current == nullptr) {
+        return;
+    }
+    // Only reported once, as the frames after it usually have as many zones
+    if (current->droppedZoneCount > 0 && !reportedDroppedZones) {
+        fprintf(stderr, "GPU profiler: %u zones past the first %d of a frame were not measured\n",
+                current->droppedZoneCount, GPU_PROFILER_MAX_ZONES);
+        reportedDroppedZones = true;
+    }
+    // The frame zone's end is written last, which is what readBack checks for
+    glQueryCounter(current->queries[1], GL_TIMESTAMP);
+    current->pending = true;
+    current = nullptr;
+}
+
+unsigned int GPUProfiler::beginZone(const char *name) {
+    if (current == nullptr) {
+        return invalidZone;
+    }
+    if (current->zoneCount == GPU_PROFILER_MAX_ZONES) {
+        current->droppedZoneCount++;
+        return invalidZone;
+    }
+    unsigned int zone = current->zoneCount++;
+    current->zones[zone].name = name;
+    glQueryCounter(current->queries[2 * zone], GL_TIMESTAMP);
+    return zone;
+}
+
+void GPUProfiler::endZone(unsigned int zone) {
+    // Zone 0 is ended by endFrame
+    if (current == nullptr || zone == invalidZone || zone == 0) {
+        return;
+    }
+    glQueryCounter(current->queries[2 * zone + 1], GL_TIMESTAMP);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+
+// Frames of queries in flight. Results are read back once the GPU has finished a frame,
+// normally two or three frames after it was recorded.
+#define GPU_PROFILER_FRAMES 4
+// Zones per frame beyond this are not measured; the first frame with more is reported
+#define GPU_PROFILER_MAX_ZONES 64
+
+// GPU_ZONE(profiler, "name") measures the GPU time of the commands issued in the rest of
+// the enclosing scope. Zones must be opened and closed between beginFrame and endFrame.
+#define GPU_ZONE_CONCATENATE_(a, b) a##b
+#define GPU_ZONE_CONCATENATE(a, b) GPU_ZONE_CONCATENATE_(a, b)
+#define GPU_ZONE(profiler, name) GPUZone GPU_ZONE_CONCATENATE(gpuZone, __LINE__)(profiler, name)
+
+struct ProfileTrack;
+
+// Measures passes on the GPU with GL_TIMESTAMP queries, without ever waiting for them.
+// Every zone writes a timestamp at its start and end. The queries of each frame come
+// from a pool that is only reused after GL_QUERY_RESULT_AVAILABLE has reported all of
+// its results; if the GPU falls GPU_PROFILER_FRAMES frames behind, frames go unmeasured
+// instead. Read back zones are added to the "GPU" track of the CPU profiler trace.
+class GPUProfiler {
+  public:
+    GPUProfiler();
+
+    void beginFrame();
+    void endFrame();
+
+    // Returns a handle to pass to endZone
+    unsigned int beginZone(const char *name);
+    void endZone(unsigned int zone);
+
+    // GPU time between beginFrame and endFrame of the newest frame that has been read back
+    double lastFrameMilliseconds() const { return lastFrameMs; }
+
+    GPUProfiler(GPUProfiler const &) = delete;
+    GPUProfiler &operator=(GPUProfiler const &) = delete;
+
+  private:
+    struct Zone {
+        const char *name;
+        GLuint64 start;
+        GLuint64 end;
+    };
+
+    struct Frame {
+        // Two timestamps per zone. Zone 0 spans the whole frame.
+        GLuint queries[2 * GPU_PROFILER_MAX_ZONES];
+        Zone zones[GPU_PROFILER_MAX_ZONES];
+        unsigned int zoneCount = 0;
+        unsigned int droppedZoneCount = 0;
+        // Added to GPU timestamps to place them on the CPU profiler's clock
+        int64_t clockOffset = 0;
+        bool pending = false;
+    };
+
+    void readBack(Frame &frame);
+
+    Frame frames[GPU_PROFILER_FRAMES];
+    // The frame being recorded, or nullptr if its queries were still in flight
+    Frame *current = nullptr;
+    unsigned int frameIndex = 0;
+    double lastFrameMs = 0;
+    bool reportedDroppedZones = false;
+    ProfileTrack *track;
+};
+
+class GPUZone {
+  public:
+    GPUZone(GPUProfiler &profiler, const char *name) : profiler(profiler), zone(profiler.beginZone(name)) {}
+    ~GPUZone() { profiler.endZone(zone); }
+
+    GPUZone(GPUZone const &) = delete;
+    GPUZone &operator=(GPUZone const &) = delete;
+
+  private:
+    GPUProfiler &profiler;
+    unsigned int zone;
+};
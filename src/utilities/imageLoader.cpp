@@ -1,9 +1,31 @@
 #include "imageLoader.hpp"
+#include "profiler.h"
 #include <iostream>
 
+void flipVertically(PNGImage &image)
+{
+	// Unfortunately, images usually have their origin at the top left.
+	// OpenGL instead defines the origin to be on the _bottom_ left instead, so
+	// here's the world's most inefficient way to flip the image vertically.
+
+	// You're welcome :)
+
+	unsigned int widthBytes = 4 * image.width;
+	unsigned int height = image.height;
+	std::vector<unsigned char> &pixels = image.pixels;
+
+	for(unsigned int row = 0; row < (height / 2); row++) {
+		for(unsigned int col = 0; col < widthBytes; col++) {
+			std::swap(pixels[row * widthBytes + col], pixels[(height - 1 - row) * widthBytes + col]);
+		}
+	}
+}
+
 // Original source: https://raw.githubusercontent.com/lvandeve/lodepng/master/examples/example_decode.cpp
 PNGImage loadPNGFile(std::string fileName)
 {
+	PROFILE_ZONE("loadPNGFile");
+
 	std::vector<unsigned char> png;
 	std::vector<unsigned char> pixels; //the raw pixels
 	unsigned int width, height;
@@ -17,25 +39,13 @@ PNGImage loadPNGFile(std::string fileName)
 
 	//the pixels are now in the vector "image", 4 bytes per pixel, ordered RGBARGBA..., use it as texture, draw it, ...
 
-	// Unfortunately, images usually have their origin at the top left.
-	// OpenGL instead defines the origin to be on the _bottom_ left instead, so
-	// here's the world's most inefficient way to flip the image vertically.
-
-	// You're welcome :)
-
-	unsigned int widthBytes = 4 * width;
-
-	for(unsigned int row = 0; row < (height / 2); row++) {
-		for(unsigned int col = 0; col < widthBytes; col++) {
-			std::swap(pixels[row * widthBytes + col], pixels[(height - 1 - row) * widthBytes + col]);
-		}
-	}
-
 	PNGImage image;
 	image.width = width;
 	image.height = height;
 	image.pixels = pixels;
 
+	flipVertically(image);
+
 	return image;
 
 }
\ No newline at end of file
@@ -11,3 +11,6 @@ typedef struct PNGImage {
 } PNGImage;
 
 PNGImage loadPNGFile(std::string fileName);
+
+// Turns the rows of an RGBA image upside down, as loadPNGFile does for OpenGL
+void flipVertically(PNGImage &image);
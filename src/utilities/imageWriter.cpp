@@ -0,0 +1,110 @@
+#include "imageWriter.h"
+#include "profiler.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <lodepng.h>
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+
+static void appendBigEndian(std::vector<unsigned char> &bytes, unsigned int value) {
+    bytes.push_back(value >> 24);
+    bytes.push_back(value >> 16);
+    bytes.push_back(value >> 8);
+    bytes.push_back(value);
+}
+
+std::vector<unsigned char> encodeQOI(const unsigned char *pixels, unsigned int width, unsigned int height) {
+    PROFILE_ZONE("encodeQOI");
+
+    std::vector<unsigned char> bytes;
+    // Header, the worst case of four bytes per pixel, and the end marker
+    bytes.reserve(14 + size_t(width) * height * 4 + 8);
+    bytes.insert(bytes.end(), {'q', 'o', 'i', 'f'});
+    appendBigEndian(bytes, width);
+    appendBigEndian(bytes, height);
+    // Three channels, sRGB
+    bytes.push_back(3);
+    bytes.push_back(0);
+
+    // Alpha is always 255, but the index starts out as transparent black like the
+    // decoder's, so a black pixel only matches slot 53 once it has been stored there
+    unsigned char index[64][4] = {};
+    unsigned char previous[3] = {0, 0, 0};
+    unsigned int run = 0;
+    const size_t pixelCount = size_t(width) * height;
+
+    for (size_t i = 0; i < pixelCount; i++) {
+        const unsigned char *pixel = pixels + 4 * i;
+        if (std::memcmp(pixel, previous, 3) == 0) {
+            run++;
+            if (run == 62 || i + 1 == pixelCount) {
+                bytes.push_back(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            bytes.push_back(QOI_OP_RUN | (run - 1));
+            run = 0;
+        }
+
+        const unsigned char opaque[4] = {pixel[0], pixel[1], pixel[2], 255};
+        unsigned int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + 255 * 11) % 64;
+        if (std::memcmp(index[hash], opaque, 4) == 0) {
+            bytes.push_back(QOI_OP_INDEX | hash);
+        } else {
+            std::memcpy(index[hash], opaque, 4);
+
+            int8_t dr = int8_t(pixel[0] - previous[0]);
+            int8_t dg = int8_t(pixel[1] - previous[1]);
+            int8_t db = int8_t(pixel[2] - previous[2]);
+            int drg = dr - dg;
+            int dbg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                bytes.push_back(QOI_OP_DIFF | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+            } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                bytes.push_back(QOI_OP_LUMA | (dg + 32));
+                bytes.push_back((drg + 8) << 4 | (dbg + 8));
+            } else {
+                bytes.insert(bytes.end(), {QOI_OP_RGB, pixel[0], pixel[1], pixel[2]});
+            }
+        }
+        std::memcpy(previous, pixel, 3);
+    }
+
+    bytes.insert(bytes.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+    return bytes;
+}
+
+bool writeQOIFile(const std::string &fileName, const unsigned char *pixels, unsigned int width, unsigned int height) {
+    std::vector<unsigned char> bytes = encodeQOI(pixels, width, height);
+
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Could not write %s\n", fileName.c_str());
+        return false;
+    }
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    fclose(file);
+    return written;
+}
+
+bool writePNGFile(const std::string &fileName, const unsigned char *pixels, unsigned int width, unsigned int height) {
+    PROFILE_ZONE("encodePNG");
+
+    std::vector<unsigned char> rgb(size_t(width) * height * 3);
+    for (size_t i = 0; i < size_t(width) * height; i++) {
+        std::memcpy(&rgb[3 * i], pixels + 4 * i, 3);
+    }
+    unsigned error = lodepng::encode(fileName, rgb.data(), width, height, LCT_RGB);
+    if (error) {
+        fprintf(stderr, "Could not write %s: %s\n", fileName.c_str(), lodepng_error_text(error));
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Both take tightly packed RGBA pixels, top row first, and store them without alpha
+
+// QOI ("Quite OK Image Format", qoiformat.org) encodes an order of magnitude faster
+// than PNG at a similar size for rendered frames
+std::vector<unsigned char> encodeQOI(const unsigned char *pixels, unsigned int width, unsigned int height);
+
+bool writeQOIFile(const std::string &fileName, const unsigned char *pixels, unsigned int width, unsigned int height);
+bool writePNGFile(const std::string &fileName, const unsigned char *pixels, unsigned int width, unsigned int height);
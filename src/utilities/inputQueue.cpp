@@ -0,0 +1,21 @@
+#include "inputQueue.h"
+
+bool InputQueue::push(const InputEvent &event) {
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail - head.load(std::memory_order_acquire) == INPUT_QUEUE_CAPACITY) {
+        return false;
+    }
+    events[currentTail % INPUT_QUEUE_CAPACITY] = event;
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+}
+
+bool InputQueue::pop(InputEvent &event) {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    event = events[currentHead % INPUT_QUEUE_CAPACITY];
+    head.store(currentHead + 1, std::memory_order_release);
+    return true;
+}
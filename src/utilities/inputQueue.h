@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Events beyond this many that have not been consumed yet are dropped
+#define INPUT_QUEUE_CAPACITY 1024
+
+enum class InputEventType { MouseMotion, MouseButton, Key };
+
+struct InputEvent {
+    InputEventType type;
+    // glfwGetTime() when the event was received
+    double time;
+    // MouseMotion: movement since the previous motion event
+    double deltaX;
+    double deltaY;
+    // MouseButton and Key: the GLFW button or key, and whether it was pressed or released
+    int code;
+    bool pressed;
+};
+
+// Fixed size ring buffer of input events, written by the GLFW callbacks and read by
+// whoever updates the game. One producer and one consumer may use it concurrently
+// without locks; neither side ever allocates.
+class InputQueue {
+  public:
+    // Returns false if the queue is full
+    bool push(const InputEvent &event);
+    // Returns false if the queue is empty
+    bool pop(InputEvent &event);
+
+  private:
+    InputEvent events[INPUT_QUEUE_CAPACITY];
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
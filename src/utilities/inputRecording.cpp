@@ -0,0 +1,129 @@
+#include "inputRecording.h"
+#include <cstdint>
+#include <cstring>
+
+struct InputRecordingHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t flags;
+};
+
+static const char inputRecordingMagic[4] = {'G', 'B', 'I', 'N'};
+// Version 2 widened the event count of a frame from 16 to 32 bits
+static const uint32_t inputRecordingVersion = 2;
+static const uint32_t autoplayFlag = 1 << 0;
+
+template <class T> static void append(std::vector<unsigned char> &bytes, const T &value) {
+    const unsigned char *valueBytes = reinterpret_cast<const unsigned char *>(&value);
+    bytes.insert(bytes.end(), valueBytes, valueBytes + sizeof(T));
+}
+
+bool InputRecorder::open(const std::string &fileName, const RecordingSettings &settings) {
+    close();
+    file = fopen(fileName.c_str(), "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Could not write input recording to %s\n", fileName.c_str());
+        return false;
+    }
+
+    InputRecordingHeader header;
+    std::memcpy(header.magic, inputRecordingMagic, sizeof(header.magic));
+    header.version = inputRecordingVersion;
+    header.flags = settings.autoplay ? autoplayFlag : 0;
+    fwrite(&header, sizeof(header), 1, file);
+    return true;
+}
+
+void InputRecorder::close() {
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+void InputRecorder::recordEvent(const InputEvent &event) {
+    if (file == nullptr) {
+        return;
+    }
+    append(frameEvents, uint8_t(event.type));
+    if (event.type == InputEventType::MouseMotion) {
+        append(frameEvents, event.deltaX);
+        append(frameEvents, event.deltaY);
+    } else {
+        append(frameEvents, int16_t(event.code));
+        append(frameEvents, uint8_t(event.pressed));
+    }
+    frameEventCount++;
+}
+
+void InputRecorder::endFrame(double timeDelta) {
+    if (file == nullptr) {
+        return;
+    }
+    fwrite(&timeDelta, sizeof(timeDelta), 1, file);
+    fwrite(&frameEventCount, sizeof(frameEventCount), 1, file);
+    fwrite(frameEvents.data(), 1, frameEvents.size(), file);
+    frameEvents.clear();
+    frameEventCount = 0;
+}
+
+InputReplay::InputReplay(const std::string &fileName) : file(fileName) {
+    if (!file.isOpen() || file.size() < sizeof(InputRecordingHeader)) {
+        fprintf(stderr, "Could not read input recording %s\n", fileName.c_str());
+        return;
+    }
+
+    InputRecordingHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, inputRecordingMagic, sizeof(header.magic)) != 0 ||
+        header.version != inputRecordingVersion) {
+        fprintf(stderr, "%s is not an input recording of this version\n", fileName.c_str());
+        return;
+    }
+
+    recordedSettings.autoplay = (header.flags & autoplayFlag) != 0;
+    position = sizeof(header);
+    valid = true;
+}
+
+// Copies a value out of the log, returning false if it would read past the end
+template <class T> static bool read(const MappedFile &file, size_t &position, T &value) {
+    if (file.size() - position < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, file.data() + position, sizeof(T));
+    position += sizeof(T);
+    return true;
+}
+
+bool InputReplay::nextFrame(double &timeDelta, std::vector<InputEvent> &events) {
+    events.clear();
+    uint32_t eventCount;
+    if (!valid || !read(file, position, timeDelta) || !read(file, position, eventCount)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < eventCount; i++) {
+        InputEvent event = {InputEventType::MouseMotion, -1, 0, 0, 0, false};
+        uint8_t type;
+        if (!read(file, position, type)) {
+            return false;
+        }
+        event.type = InputEventType(type);
+        if (event.type == InputEventType::MouseMotion) {
+            if (!read(file, position, event.deltaX) || !read(file, position, event.deltaY)) {
+                return false;
+            }
+        } else {
+            int16_t code;
+            uint8_t pressed;
+            if (!read(file, position, code) || !read(file, position, pressed)) {
+                return false;
+            }
+            event.code = code;
+            event.pressed = pressed != 0;
+        }
+        events.push_back(event);
+    }
+    return true;
+}
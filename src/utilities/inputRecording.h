@@ -0,0 +1,59 @@
+#pragma once
+
+#include "inputQueue.h"
+#include "mappedFile.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Settings of the recorded run that change how the game plays
+struct RecordingSettings {
+    bool autoplay = false;
+};
+
+// Writes the time delta and input events of every simulated frame to a binary log, so
+// the run can be reproduced exactly with InputReplay. Writes go through stdio's buffer,
+// so recording does not touch the disk every frame.
+//
+// Layout: a header, then per frame the time delta (double), the number of events (uint32)
+// and the events. Events are a type byte followed by two doubles for mouse motion, or an
+// int16 code and a pressed byte for buttons and keys.
+class InputRecorder {
+  public:
+    ~InputRecorder() { close(); }
+
+    bool open(const std::string &fileName, const RecordingSettings &settings);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    // Adds an event to the current frame, in the order it is applied to the game
+    void recordEvent(const InputEvent &event);
+    // Writes the current frame and starts the next one
+    void endFrame(double timeDelta);
+
+  private:
+    FILE *file = nullptr;
+    std::vector<unsigned char> frameEvents;
+    uint32_t frameEventCount = 0;
+};
+
+// Reads a log written by InputRecorder, one frame at a time
+class InputReplay {
+  public:
+    explicit InputReplay(const std::string &fileName);
+
+    // False if the file is missing or is not an input recording
+    bool isOpen() const { return valid; }
+    const RecordingSettings &settings() const { return recordedSettings; }
+
+    // Returns the events of the next frame, with their times set to -1. Returns false at
+    // the end of the log, or if the rest of it is truncated.
+    bool nextFrame(double &timeDelta, std::vector<InputEvent> &events);
+
+  private:
+    MappedFile file;
+    size_t position = 0;
+    bool valid = false;
+    RecordingSettings recordedSettings;
+};
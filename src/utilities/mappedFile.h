@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. The mapping is released when the object is destroyed.
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string &fileName);
+    ~MappedFile();
+
+    bool isOpen() const { return mappedData != nullptr; }
+    const char *data() const { return static_cast<const char *>(mappedData); }
+    size_t size() const { return mappedSize; }
+
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+
+  private:
+    void *mappedData = nullptr;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
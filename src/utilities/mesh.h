@@ -7,6 +7,8 @@ struct Mesh {
     std::vector<glm::vec3> vertices;
     std::vector<glm::vec3> normals;
     std::vector<glm::vec2> textureCoordinates;
+    // Optional, see generateTangents. The sign of the bitangent is stored in w.
+    std::vector<glm::vec4> tangents;
 
     std::vector<unsigned int> indices;
 };
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "meshOptimizer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+
+static const unsigned int invalidIndex = ~0u;
+
+// FNV-1a, fed one attribute at a time
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <class T> static uint64_t hashAttribute(uint64_t hash, const std::vector<T> &attribute, unsigned int vertex) {
+    return attribute.empty() ? hash : hashBytes(hash, &attribute[vertex], sizeof(T));
+}
+
+template <class T>
+static bool sameAttribute(const std::vector<T> &attribute, unsigned int a, unsigned int b) {
+    return attribute.empty() || std::memcmp(&attribute[a], &attribute[b], sizeof(T)) == 0;
+}
+
+// Moves every vertex to remap[vertex]. Vertices mapping to the same slot must be identical.
+template <class T>
+static void remapAttribute(std::vector<T> &attribute, const std::vector<unsigned int> &remap, size_t newCount) {
+    if (attribute.empty()) {
+        return;
+    }
+    std::vector<T> remapped(newCount);
+    for (size_t vertex = 0; vertex < remap.size(); vertex++) {
+        if (remap[vertex] != invalidIndex) {
+            remapped[remap[vertex]] = attribute[vertex];
+        }
+    }
+    attribute.swap(remapped);
+}
+
+static void remapVertices(Mesh &mesh, const std::vector<unsigned int> &remap, size_t newCount) {
+    remapAttribute(mesh.vertices, remap, newCount);
+    remapAttribute(mesh.normals, remap, newCount);
+    remapAttribute(mesh.textureCoordinates, remap, newCount);
+    remapAttribute(mesh.tangents, remap, newCount);
+    for (unsigned int &index : mesh.indices) {
+        index = remap[index];
+    }
+}
+
+// Merges vertices that are identical across all attributes, using an open addressing hash table
+static void weldVertices(Mesh &mesh) {
+    const size_t vertexCount = mesh.vertices.size();
+
+    size_t tableSize = 1;
+    while (tableSize < vertexCount * 2) {
+        tableSize *= 2;
+    }
+    std::vector<unsigned int> table(tableSize, invalidIndex);
+    std::vector<unsigned int> remap(vertexCount, invalidIndex);
+    size_t uniqueCount = 0;
+
+    for (unsigned int vertex = 0; vertex < vertexCount; vertex++) {
+        uint64_t hash = 14695981039346656037ull;
+        hash = hashAttribute(hash, mesh.vertices, vertex);
+        hash = hashAttribute(hash, mesh.normals, vertex);
+        hash = hashAttribute(hash, mesh.textureCoordinates, vertex);
+        hash = hashAttribute(hash, mesh.tangents, vertex);
+
+        size_t slot = hash & (tableSize - 1);
+        while (true) {
+            unsigned int existing = table[slot];
+            if (existing == invalidIndex) {
+                table[slot] = vertex;
+                remap[vertex] = uniqueCount++;
+                break;
+            }
+            if (sameAttribute(mesh.vertices, existing, vertex) && sameAttribute(mesh.normals, existing, vertex) &&
+                sameAttribute(mesh.textureCoordinates, existing, vertex) &&
+                sameAttribute(mesh.tangents, existing, vertex)) {
+                remap[vertex] = remap[existing];
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+    }
+
+    remapVertices(mesh, remap, uniqueCount);
+}
+
+float averageCacheMissRatio(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize) {
+    if (indices.empty()) {
+        return 0;
+    }
+
+    // A FIFO cache only changes on misses, so a vertex is still cached if fewer than
+    // cacheSize misses happened since it was last inserted
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (unsigned int index : indices) {
+        if (insertedAt[index] == 0 || misses - insertedAt[index] >= cacheSize) {
+            misses++;
+            insertedAt[index] = misses;
+        }
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+VertexAdjacency buildAdjacency(const std::vector<unsigned int> &indices, size_t vertexCount) {
+    VertexAdjacency adjacency;
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (unsigned int index : indices) {
+        adjacency.offsets[index + 1]++;
+    }
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+    std::vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    adjacency.triangles.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency.triangles[fill[indices[i]]++] = i / 3;
+    }
+    return adjacency;
+}
+
+// Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw", 2007). Fans out around one vertex at a time, choosing the
+// next fanning vertex among the ones still in the cache. clusterStarts receives the
+// triangle positions where the walk had to jump to an unrelated part of the mesh.
+static std::vector<unsigned int> tipsify(const std::vector<unsigned int> &indices, size_t vertexCount,
+                                         unsigned int cacheSize, std::vector<size_t> &clusterStarts) {
+    const size_t triangleCount = indices.size() / 3;
+    VertexAdjacency adjacency = buildAdjacency(indices, vertexCount);
+
+    std::vector<unsigned int> liveTriangles(vertexCount);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        liveTriangles[vertex] = adjacency.offsets[vertex + 1] - adjacency.offsets[vertex];
+    }
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    clusterStarts.assign(1, 0);
+
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;
+    unsigned int fanningVertex = indices.empty() ? invalidIndex : 0;
+
+    while (fanningVertex != invalidIndex) {
+        candidates.clear();
+
+        for (unsigned int a = adjacency.offsets[fanningVertex]; a < adjacency.offsets[fanningVertex + 1]; a++) {
+            unsigned int triangle = adjacency.triangles[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int vertex = indices[3 * triangle + corner];
+                output.push_back(vertex);
+                deadEnds.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time++;
+                }
+            }
+        }
+
+        // Prefer the candidate that stays in the cache the longest while its
+        // remaining triangles are emitted
+        fanningVertex = invalidIndex;
+        size_t bestPriority = 0;
+        for (unsigned int vertex : candidates) {
+            if (liveTriangles[vertex] == 0) {
+                continue;
+            }
+            size_t priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                priority = time - cacheTime[vertex];
+            }
+            if (fanningVertex == invalidIndex || priority > bestPriority) {
+                fanningVertex = vertex;
+                bestPriority = priority;
+            }
+        }
+        if (fanningVertex != invalidIndex) {
+            continue;
+        }
+
+        // Dead end: go back to a recently used vertex, or start somewhere new
+        while (!deadEnds.empty() && fanningVertex == invalidIndex) {
+            unsigned int vertex = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[vertex] > 0) {
+                fanningVertex = vertex;
+            }
+        }
+        while (fanningVertex == invalidIndex && cursor < vertexCount) {
+            if (liveTriangles[cursor] > 0) {
+                fanningVertex = cursor;
+                clusterStarts.push_back(output.size() / 3);
+            }
+            cursor++;
+        }
+    }
+
+    return output;
+}
+
+// Sorts the clusters found by tipsify so that the ones facing away from the centre
+// of the mesh are drawn first, as they are the most likely to occlude the rest
+static void sortClustersForOverdraw(Mesh &mesh, const std::vector<size_t> &clusterStarts) {
+    const size_t triangleCount = mesh.indices.size() / 3;
+
+    glm::vec3 meshCentre(0);
+    for (const glm::vec3 &vertex : mesh.vertices) {
+        meshCentre += vertex;
+    }
+    meshCentre /= float(std::max<size_t>(mesh.vertices.size(), 1));
+
+    struct Cluster {
+        size_t start;
+        size_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters;
+    for (size_t c = 0; c < clusterStarts.size(); c++) {
+        Cluster cluster;
+        cluster.start = clusterStarts[c];
+        cluster.end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+
+        // Area weighted normal and centroid of the cluster
+        glm::vec3 normal(0);
+        glm::vec3 centroid(0);
+        float area = 0;
+        for (size_t triangle = cluster.start; triangle < cluster.end; triangle++) {
+            const glm::vec3 &v0 = mesh.vertices[mesh.indices[3 * triangle + 0]];
+            const glm::vec3 &v1 = mesh.vertices[mesh.indices[3 * triangle + 1]];
+            const glm::vec3 &v2 = mesh.vertices[mesh.indices[3 * triangle + 2]];
+            glm::vec3 faceNormal = glm::cross(v1 - v0, v2 - v0);
+            float faceArea = glm::length(faceNormal);
+            normal += faceNormal;
+            centroid += (v0 + v1 + v2) * (faceArea / 3.0f);
+            area += faceArea;
+        }
+        if (area > 0) {
+            centroid /= area;
+        }
+        cluster.sortKey = glm::dot(centroid - meshCentre, normal);
+        clusters.push_back(cluster);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(mesh.indices.size());
+    for (const Cluster &cluster : clusters) {
+        sorted.insert(sorted.end(), mesh.indices.begin() + 3 * cluster.start, mesh.indices.begin() + 3 * cluster.end);
+    }
+    mesh.indices.swap(sorted);
+}
+
+// Stores the vertices in the order the index buffer first references them
+static void optimizeVertexFetch(Mesh &mesh) {
+    std::vector<unsigned int> remap(mesh.vertices.size(), invalidIndex);
+    unsigned int next = 0;
+    for (unsigned int index : mesh.indices) {
+        if (remap[index] == invalidIndex) {
+            remap[index] = next++;
+        }
+    }
+    remapVertices(mesh, remap, next);
+}
+
+MeshOptimizationStats optimizeMesh(Mesh &mesh, bool optimizeOverdraw) {
+    MeshOptimizationStats stats;
+    stats.verticesBefore = mesh.vertices.size();
+    stats.acmrBefore = averageCacheMissRatio(mesh.indices, mesh.vertices.size());
+
+    weldVertices(mesh);
+
+    std::vector<size_t> clusterStarts;
+    mesh.indices = tipsify(mesh.indices, mesh.vertices.size(), VERTEX_CACHE_SIZE, clusterStarts);
+    if (optimizeOverdraw) {
+        sortClustersForOverdraw(mesh, clusterStarts);
+    }
+
+    optimizeVertexFetch(mesh);
+
+    stats.verticesAfter = mesh.vertices.size();
+    stats.acmrAfter = averageCacheMissRatio(mesh.indices, mesh.vertices.size());
+    return stats;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "mesh.h"
+#include <cstddef>
+
+// Size of the FIFO post-transform cache assumed when ordering and measuring meshes
+#define VERTEX_CACHE_SIZE 16
+
+struct MeshOptimizationStats {
+    size_t verticesBefore;
+    size_t verticesAfter;
+    // Average cache miss ratio: transformed vertices per triangle, between 0.5 and 3
+    float acmrBefore;
+    float acmrAfter;
+};
+
+// Welds vertices whose attributes (tangents included) are bitwise identical, orders the
+// triangles for the post-transform vertex cache (Tipsify) and stores the vertices in the
+// order they are first used. With optimizeOverdraw, clusters of triangles are additionally sorted so
+// that outward facing parts of the mesh are drawn first. Runs in linear time.
+MeshOptimizationStats optimizeMesh(Mesh &mesh, bool optimizeOverdraw = false);
+
+// Triangles grouped by the vertices they use: the triangles using vertex v are
+// triangles[offsets[v]] up to (but not including) triangles[offsets[v + 1]]
+struct VertexAdjacency {
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> triangles;
+};
+
+VertexAdjacency buildAdjacency(const std::vector<unsigned int> &indices, size_t vertexCount);
+
+float averageCacheMissRatio(const std::vector<unsigned int> &indices, size_t vertexCount,
+                            unsigned int cacheSize = VERTEX_CACHE_SIZE);
@@ -0,0 +1,428 @@
+#include "objLoader.h"
+#include "glutils.h"
+#include "mappedFile.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <sceneGraph.hpp>
+#include <thread>
+
+// Files smaller than two of these are parsed on a single thread
+#define OBJ_MIN_CHUNK_SIZE (4 << 20)
+
+// Bits of OBJCorner::relative
+#define OBJ_RELATIVE_POSITION 1
+#define OBJ_RELATIVE_TEXTURE_COORDINATE 2
+#define OBJ_RELATIVE_NORMAL 4
+
+static const int64_t missingParsedIndex = INT64_MIN;
+static const int32_t missingIndex = -1;
+
+// Indices of one face corner, as parsed. Absolute indices are 0-based indices into the
+// whole file. Relative ones are resolved against the chunk and counted from its start,
+// so they are negative when they point into an earlier chunk; merging adds the chunk's
+// offset to them. The bits in relative say which indices are relative.
+struct OBJCorner {
+    int64_t position;
+    int64_t textureCoordinate;
+    int64_t normal;
+    uint8_t relative;
+};
+
+// Indices of one face corner into the merged arrays, or missingIndex
+struct OBJVertex {
+    int32_t position;
+    int32_t textureCoordinate;
+    int32_t normal;
+};
+
+struct OBJObjectStart {
+    size_t firstCorner;
+    std::string name;
+};
+
+struct OBJChunk {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> textureCoordinates;
+    std::vector<glm::vec3> normals;
+    // Three per triangle
+    std::vector<OBJCorner> corners;
+    std::vector<OBJObjectStart> objects;
+
+    // Where this chunk's positions, texture coordinates and normals start in the merged arrays
+    size_t positionOffset = 0;
+    size_t textureCoordinateOffset = 0;
+    size_t normalOffset = 0;
+};
+
+static const char *skipSpaces(const char *c, const char *end) {
+    while (c < end && (*c == ' ' || *c == '\t')) {
+        c++;
+    }
+    return c;
+}
+
+static const char *skipLine(const char *c, const char *end) {
+    while (c < end && *c != '\n') {
+        c++;
+    }
+    return c < end ? c + 1 : end;
+}
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char *parseInt(const char *c, const char *end, int32_t &value) {
+    bool negative = false;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = *c == '-';
+        c++;
+    }
+    int64_t result = 0;
+    while (c < end && isDigit(*c)) {
+        result = result * 10 + (*c - '0');
+        c++;
+    }
+    value = int32_t(negative ? -result : result);
+    return c;
+}
+
+// Decimal float parser that avoids strtod's locale handling. The mantissa is gathered
+// as an integer and scaled once; this is exact for the usual 6-9 significant digits.
+static const char *parseFloat(const char *c, const char *end, float &value) {
+    static const double powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    c = skipSpaces(c, end);
+    bool negative = false;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = *c == '-';
+        c++;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    while (c < end && isDigit(*c)) {
+        if (digits < 18) {
+            mantissa = mantissa * 10 + (*c - '0');
+            digits += mantissa != 0;
+        } else {
+            exponent++;
+        }
+        c++;
+    }
+    if (c < end && *c == '.') {
+        c++;
+        while (c < end && isDigit(*c)) {
+            if (digits < 18) {
+                mantissa = mantissa * 10 + (*c - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+            c++;
+        }
+    }
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        int32_t explicitExponent;
+        c = parseInt(c + 1, end, explicitExponent);
+        exponent += explicitExponent;
+    }
+
+    double result = double(mantissa);
+    if (exponent < 0) {
+        result = -exponent <= 22 ? result / powersOfTen[-exponent] : result * std::pow(10.0, exponent);
+    } else if (exponent > 0) {
+        result = exponent <= 22 ? result * powersOfTen[exponent] : result * std::pow(10.0, exponent);
+    }
+    value = float(negative ? -result : result);
+    return c;
+}
+
+static int64_t resolveIndex(int32_t index, size_t countInChunk, uint8_t relativeBit, uint8_t &relative) {
+    if (index > 0) {
+        return index - 1;
+    }
+    if (index < 0) {
+        relative |= relativeBit;
+        return int64_t(countInChunk) + index;
+    }
+    return missingParsedIndex;
+}
+
+// Parses "v", "v/vt", "v//vn" or "v/vt/vn"
+static const char *parseCorner(const char *c, const char *end, const OBJChunk &chunk, OBJCorner &corner) {
+    int32_t index;
+    corner.relative = 0;
+    c = parseInt(c, end, index);
+    corner.position = resolveIndex(index, chunk.positions.size(), OBJ_RELATIVE_POSITION, corner.relative);
+    corner.textureCoordinate = missingParsedIndex;
+    corner.normal = missingParsedIndex;
+
+    if (c < end && *c == '/') {
+        c++;
+        if (c < end && *c != '/') {
+            c = parseInt(c, end, index);
+            corner.textureCoordinate = resolveIndex(index, chunk.textureCoordinates.size(),
+                                                    OBJ_RELATIVE_TEXTURE_COORDINATE, corner.relative);
+        }
+        if (c < end && *c == '/') {
+            c = parseInt(c + 1, end, index);
+            corner.normal = resolveIndex(index, chunk.normals.size(), OBJ_RELATIVE_NORMAL, corner.relative);
+        }
+    }
+    return c;
+}
+
+static void parseChunk(const char *c, const char *end, OBJChunk &chunk) {
+    // Reused for every face, so it only allocates for the largest polygon
+    std::vector<OBJCorner> polygon;
+
+    while (c < end) {
+        c = skipSpaces(c, end);
+        if (c + 1 >= end) {
+            break;
+        }
+
+        if (c[0] == 'v' && (c[1] == ' ' || c[1] == '\t')) {
+            glm::vec3 position;
+            c = parseFloat(c + 1, end, position.x);
+            c = parseFloat(c, end, position.y);
+            c = parseFloat(c, end, position.z);
+            chunk.positions.push_back(position);
+        } else if (c[0] == 'v' && c[1] == 't') {
+            glm::vec2 textureCoordinate;
+            c = parseFloat(c + 2, end, textureCoordinate.x);
+            c = parseFloat(c, end, textureCoordinate.y);
+            chunk.textureCoordinates.push_back(textureCoordinate);
+        } else if (c[0] == 'v' && c[1] == 'n') {
+            glm::vec3 normal;
+            c = parseFloat(c + 2, end, normal.x);
+            c = parseFloat(c, end, normal.y);
+            c = parseFloat(c, end, normal.z);
+            chunk.normals.push_back(normal);
+        } else if (c[0] == 'f' && (c[1] == ' ' || c[1] == '\t')) {
+            polygon.clear();
+            c = skipSpaces(c + 1, end);
+            while (c < end && (isDigit(*c) || *c == '-')) {
+                OBJCorner corner;
+                c = skipSpaces(parseCorner(c, end, chunk, corner), end);
+                polygon.push_back(corner);
+            }
+            for (size_t i = 2; i < polygon.size(); i++) {
+                chunk.corners.push_back(polygon[0]);
+                chunk.corners.push_back(polygon[i - 1]);
+                chunk.corners.push_back(polygon[i]);
+            }
+        } else if ((c[0] == 'o' || c[0] == 'g') && (c[1] == ' ' || c[1] == '\t')) {
+            const char *nameStart = skipSpaces(c + 1, end);
+            const char *nameEnd = nameStart;
+            while (nameEnd < end && *nameEnd != '\n' && *nameEnd != '\r') {
+                nameEnd++;
+            }
+            chunk.objects.push_back({chunk.corners.size(), std::string(nameStart, nameEnd)});
+            c = nameEnd;
+        }
+
+        c = skipLine(c, end);
+    }
+}
+
+// Turns an index stored by parseCorner into an index into the merged arrays
+static int32_t globalIndex(int64_t index, bool relative, size_t chunkOffset, size_t count) {
+    if (index == missingParsedIndex) {
+        return missingIndex;
+    }
+    int64_t global = relative ? int64_t(chunkOffset) + index : index;
+    return global >= 0 && global < int64_t(count) ? int32_t(global) : missingIndex;
+}
+
+// A run of corners in one chunk that belongs to an object
+struct OBJCornerRange {
+    const OBJChunk *chunk;
+    size_t begin;
+    size_t end;
+};
+
+struct OBJMergedData {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> textureCoordinates;
+    std::vector<glm::vec3> normals;
+};
+
+static Mesh buildMesh(const std::vector<OBJCornerRange> &ranges, const OBJMergedData &data) {
+    size_t cornerCount = 0;
+    for (const OBJCornerRange &range : ranges) {
+        cornerCount += range.end - range.begin;
+    }
+
+    // Open addressing table from resolved corners to vertex indices
+    size_t tableSize = 1;
+    while (tableSize < cornerCount * 2) {
+        tableSize *= 2;
+    }
+    std::vector<uint32_t> table(tableSize, UINT32_MAX);
+    std::vector<OBJVertex> uniqueCorners;
+    uniqueCorners.reserve(cornerCount / 4);
+
+    Mesh mesh;
+    mesh.indices.reserve(cornerCount);
+    bool hasTextureCoordinates = false;
+    bool hasNormals = false;
+
+    for (const OBJCornerRange &range : ranges) {
+        const OBJChunk &chunk = *range.chunk;
+        for (size_t triangle = range.begin; triangle + 2 < range.end; triangle += 3) {
+            OBJVertex resolved[3];
+            bool valid = true;
+            for (int i = 0; i < 3; i++) {
+                const OBJCorner &corner = chunk.corners[triangle + i];
+                resolved[i].position = globalIndex(corner.position, corner.relative & OBJ_RELATIVE_POSITION,
+                                                   chunk.positionOffset, data.positions.size());
+                resolved[i].textureCoordinate =
+                    globalIndex(corner.textureCoordinate, corner.relative & OBJ_RELATIVE_TEXTURE_COORDINATE,
+                                chunk.textureCoordinateOffset, data.textureCoordinates.size());
+                resolved[i].normal = globalIndex(corner.normal, corner.relative & OBJ_RELATIVE_NORMAL,
+                                                 chunk.normalOffset, data.normals.size());
+                valid = valid && resolved[i].position != missingIndex;
+            }
+            if (!valid) {
+                continue;
+            }
+
+            for (const OBJVertex &corner : resolved) {
+                uint64_t hash = uint32_t(corner.position) * 0x9E3779B97F4A7C15ull;
+                hash ^= (uint32_t(corner.textureCoordinate) + (hash << 6) + (hash >> 2)) * 0xC2B2AE3D27D4EB4Full;
+                hash ^= (uint32_t(corner.normal) + (hash << 6) + (hash >> 2)) * 0x165667B19E3779F9ull;
+
+                size_t slot = (hash ^ (hash >> 29)) & (tableSize - 1);
+                while (table[slot] != UINT32_MAX) {
+                    const OBJVertex &existing = uniqueCorners[table[slot]];
+                    if (existing.position == corner.position && existing.textureCoordinate == corner.textureCoordinate &&
+                        existing.normal == corner.normal) {
+                        break;
+                    }
+                    slot = (slot + 1) & (tableSize - 1);
+                }
+                if (table[slot] == UINT32_MAX) {
+                    table[slot] = uniqueCorners.size();
+                    uniqueCorners.push_back(corner);
+                    hasTextureCoordinates = hasTextureCoordinates || corner.textureCoordinate != missingIndex;
+                    hasNormals = hasNormals || corner.normal != missingIndex;
+                }
+                mesh.indices.push_back(table[slot]);
+            }
+        }
+    }
+
+    mesh.vertices.reserve(uniqueCorners.size());
+    for (const OBJVertex &corner : uniqueCorners) {
+        mesh.vertices.push_back(data.positions[corner.position]);
+    }
+    if (hasTextureCoordinates) {
+        mesh.textureCoordinates.reserve(uniqueCorners.size());
+        for (const OBJVertex &corner : uniqueCorners) {
+            mesh.textureCoordinates.push_back(corner.textureCoordinate != missingIndex
+                                                  ? data.textureCoordinates[corner.textureCoordinate]
+                                                  : glm::vec2(0));
+        }
+    }
+    if (hasNormals) {
+        mesh.normals.reserve(uniqueCorners.size());
+        for (const OBJVertex &corner : uniqueCorners) {
+            mesh.normals.push_back(corner.normal != missingIndex ? data.normals[corner.normal] : glm::vec3(0));
+        }
+    }
+    return mesh;
+}
+
+std::vector<OBJObject> parseOBJ(const char *text, size_t size, size_t chunkCount) {
+    const char *begin = text;
+    const char *end = begin + size;
+
+    // Split at line boundaries
+    chunkCount = std::max<size_t>(1, chunkCount);
+    std::vector<const char *> boundaries(chunkCount + 1, end);
+    boundaries[0] = begin;
+    for (size_t i = 1; i < chunkCount; i++) {
+        const char *boundary = std::max(begin + size * i / chunkCount, boundaries[i - 1]);
+        boundaries[i] = skipLine(boundary, end);
+    }
+
+    std::vector<OBJChunk> chunks(chunkCount);
+    parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            parseChunk(boundaries[i], boundaries[i + 1], chunks[i]);
+        }
+    });
+
+    // Merge the vertex data, remembering where each chunk's data ended up
+    OBJMergedData data;
+    for (OBJChunk &chunk : chunks) {
+        chunk.positionOffset = data.positions.size();
+        chunk.textureCoordinateOffset = data.textureCoordinates.size();
+        chunk.normalOffset = data.normals.size();
+        data.positions.insert(data.positions.end(), chunk.positions.begin(), chunk.positions.end());
+        data.textureCoordinates.insert(data.textureCoordinates.end(), chunk.textureCoordinates.begin(),
+                                       chunk.textureCoordinates.end());
+        data.normals.insert(data.normals.end(), chunk.normals.begin(), chunk.normals.end());
+    }
+
+    // Objects can span several chunks; faces before the first o/g go into an unnamed object
+    std::vector<std::string> names(1);
+    std::vector<std::vector<OBJCornerRange>> objectRanges(1);
+    for (const OBJChunk &chunk : chunks) {
+        size_t rangeStart = 0;
+        for (const OBJObjectStart &start : chunk.objects) {
+            if (start.firstCorner > rangeStart) {
+                objectRanges.back().push_back({&chunk, rangeStart, start.firstCorner});
+            }
+            names.push_back(start.name);
+            objectRanges.emplace_back();
+            rangeStart = start.firstCorner;
+        }
+        if (chunk.corners.size() > rangeStart) {
+            objectRanges.back().push_back({&chunk, rangeStart, chunk.corners.size()});
+        }
+    }
+
+    std::vector<OBJObject> objects(names.size());
+    parallelFor(objects.size(), 1, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            objects[i].name = names[i];
+            objects[i].mesh = buildMesh(objectRanges[i], data);
+        }
+    });
+
+    // Drop objects without faces, such as the unnamed one when the file starts with an "o"
+    objects.erase(std::remove_if(objects.begin(), objects.end(),
+                                 [](const OBJObject &object) { return object.mesh.indices.empty(); }),
+                  objects.end());
+    return objects;
+}
+
+std::vector<OBJObject> loadOBJFile(const std::string &fileName) {
+    MappedFile file(fileName);
+    if (!file.isOpen()) {
+        fprintf(stderr, "Could not open OBJ file \"%s\".\n", fileName.c_str());
+        return {};
+    }
+    // One chunk per core
+    size_t chunkCount = std::min<size_t>(std::thread::hardware_concurrency(), file.size() / OBJ_MIN_CHUNK_SIZE);
+    return parseOBJ(file.data(), file.size(), chunkCount);
+}
+
+SceneNode *loadOBJSceneNode(const std::string &fileName) {
+    SceneNode *root = createSceneNode();
+    for (OBJObject &object : loadOBJFile(fileName)) {
+        SceneNode *node = createSceneNode();
+        node->vertexArrayObjectID = generateBuffer(object.mesh);
+        node->VAOIndexCount = object.mesh.indices.size();
+        node->VAOIndexType = indexType(object.mesh);
+        addChild(root, node);
+    }
+    return root;
+}
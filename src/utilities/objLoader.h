@@ -0,0 +1,29 @@
+#pragma once
+
+#include "mesh.h"
+#include <string>
+#include <vector>
+
+struct SceneNode;
+
+// One "o" or "g" section of an OBJ file
+struct OBJObject {
+    std::string name;
+    Mesh mesh;
+};
+
+// Loads the geometry of a Wavefront OBJ file (v, vt, vn, f, o and g statements;
+// materials are ignored). Polygons are triangulated as fans, and every unique
+// combination of position, texture coordinate and normal becomes one vertex.
+//
+// The file is memory-mapped and split into one chunk per core at line boundaries.
+// The chunks are parsed in parallel without allocating per line and merged afterwards.
+// Returns no objects if the file could not be read.
+std::vector<OBJObject> loadOBJFile(const std::string &fileName);
+
+// Parses OBJ text in memory, split into chunkCount chunks. The result is the same for
+// any number of chunks.
+std::vector<OBJObject> parseOBJ(const char *text, size_t size, size_t chunkCount);
+
+// Loads an OBJ file and uploads it, returning a node with one GEOMETRY child per object
+SceneNode *loadOBJSceneNode(const std::string &fileName);
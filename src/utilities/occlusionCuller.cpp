@@ -0,0 +1,277 @@
+#include "occlusionCuller.h"
+#include "parallel.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_SSE2
+#endif
+
+// Below this many triangles, starting threads costs more than rasterizing on one
+#define OCCLUSION_PARALLEL_TRIANGLES 256
+
+OccluderMesh makeOccluder(const Mesh &mesh) {
+    OccluderMesh occluder;
+    occluder.vertices = mesh.vertices;
+    occluder.indices = mesh.indices;
+    return occluder;
+}
+
+OcclusionCuller::OcclusionCuller() {
+    depth.resize(OCCLUSION_WIDTH * OCCLUSION_HEIGHT);
+    for (int level = 1; level < OCCLUSION_LEVELS; level++) {
+        size_t texels = size_t(OCCLUSION_WIDTH >> level) * (OCCLUSION_HEIGHT >> level);
+        nearestDepth[level].resize(texels);
+        furthestDepth[level].resize(texels);
+    }
+}
+
+void OcclusionCuller::beginFrame() {
+    triangles.clear();
+}
+
+void OcclusionCuller::addOccluder(const OccluderMesh &occluder, const glm::mat4 &mvp) {
+    glm::vec4 clip[3];
+    for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+        for (int corner = 0; corner < 3; corner++) {
+            clip[corner] = mvp * glm::vec4(occluder.vertices[occluder.indices[i + corner]], 1);
+        }
+        clipAndAdd(clip);
+    }
+}
+
+// Clips the triangle against the near plane (z >= -w), which leaves one or two triangles.
+// The other planes are left to the rasterizer's bounds.
+void OcclusionCuller::clipAndAdd(const glm::vec4 *clip) {
+    glm::vec4 polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; i++) {
+        const glm::vec4 &a = clip[i];
+        const glm::vec4 &b = clip[(i + 1) % 3];
+        float distanceA = a.z + a.w;
+        float distanceB = b.z + b.w;
+        if (distanceA >= 0) {
+            polygon[count++] = a;
+        }
+        if ((distanceA >= 0) != (distanceB >= 0)) {
+            polygon[count++] = a + (b - a) * (distanceA / (distanceA - distanceB));
+        }
+    }
+    for (int i = 2; i < count; i++) {
+        addTriangle(polygon[0], polygon[i - 1], polygon[i]);
+    }
+}
+
+void OcclusionCuller::addTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c) {
+    ScreenTriangle triangle;
+    const glm::vec4 *clip[3] = {&a, &b, &c};
+    for (int corner = 0; corner < 3; corner++) {
+        // On the near plane z = -w, which may be zero for a plane through the camera
+        float w = std::max(clip[corner]->w, 1e-6f);
+        glm::vec3 ndc = glm::vec3(*clip[corner]) / w;
+        triangle.corners[corner] =
+            glm::vec3((ndc.x * 0.5f + 0.5f) * OCCLUSION_WIDTH, (ndc.y * 0.5f + 0.5f) * OCCLUSION_HEIGHT,
+                      ndc.z * 0.5f + 0.5f);
+    }
+
+    const glm::vec3 &v0 = triangle.corners[0];
+    const glm::vec3 &v1 = triangle.corners[1];
+    const glm::vec3 &v2 = triangle.corners[2];
+    // Back faces and triangles too thin to cover a pixel centre do not occlude
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (area <= 0) {
+        return;
+    }
+    float minX = std::min(v0.x, std::min(v1.x, v2.x));
+    float maxX = std::max(v0.x, std::max(v1.x, v2.x));
+    float minY = std::min(v0.y, std::min(v1.y, v2.y));
+    float maxY = std::max(v0.y, std::max(v1.y, v2.y));
+    if (maxX < 0 || maxY < 0 || minX > OCCLUSION_WIDTH || minY > OCCLUSION_HEIGHT) {
+        return;
+    }
+    triangles.push_back(triangle);
+}
+
+void OcclusionCuller::endFrame() {
+    PROFILE_ZONE("OcclusionCuller::endFrame");
+
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    const size_t bandCount = OCCLUSION_HEIGHT / OCCLUSION_BAND_HEIGHT;
+    parallelFor(bandCount, triangles.size() >= OCCLUSION_PARALLEL_TRIANGLES ? 1 : bandCount,
+                [this](size_t begin, size_t end) {
+                    rasterizeBand(int(begin * OCCLUSION_BAND_HEIGHT), int(end * OCCLUSION_BAND_HEIGHT));
+                });
+    buildHierarchy();
+}
+
+// Edge functions are positive inside counter-clockwise triangles, and are evaluated at pixel
+// centres. The depth is affine in screen space, so it is stepped like the edges.
+void OcclusionCuller::rasterizeBand(int firstRow, int endRow) {
+    for (const ScreenTriangle &triangle : triangles) {
+        const glm::vec3 &v0 = triangle.corners[0];
+        const glm::vec3 &v1 = triangle.corners[1];
+        const glm::vec3 &v2 = triangle.corners[2];
+
+        int minY = std::max(firstRow, int(std::ceil(std::min(v0.y, std::min(v1.y, v2.y)) - 0.5f)));
+        int maxY = std::min(endRow - 1, int(std::floor(std::max(v0.y, std::max(v1.y, v2.y)) - 0.5f)));
+        int minX = std::max(0, int(std::ceil(std::min(v0.x, std::min(v1.x, v2.x)) - 0.5f)));
+        int maxX = std::min(OCCLUSION_WIDTH - 1, int(std::floor(std::max(v0.x, std::max(v1.x, v2.x)) - 0.5f)));
+        if (minY > maxY || minX > maxX) {
+            continue;
+        }
+        // Whole groups of four, which the edge tests trim back to the triangle
+        minX &= ~3;
+
+        // Edge i runs from corner i to the next, E(p) = (b - a) x (p - a)
+        const glm::vec3 *corners[3] = {&v0, &v1, &v2};
+        float stepX[3];
+        float stepY[3];
+        float rowStart[3];
+        const float startX = minX + 0.5f;
+        const float startY = minY + 0.5f;
+        for (int edge = 0; edge < 3; edge++) {
+            const glm::vec3 &a = *corners[edge];
+            const glm::vec3 &b = *corners[(edge + 1) % 3];
+            stepX[edge] = -(b.y - a.y);
+            stepY[edge] = b.x - a.x;
+            rowStart[edge] = (b.x - a.x) * (startY - a.y) - (b.y - a.y) * (startX - a.x);
+        }
+
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+        float depthStepX = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+        float depthStepY = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+        float depthRowStart = v0.z + depthStepX * (startX - v0.x) + depthStepY * (startY - v0.y);
+
+        for (int y = minY; y <= maxY; y++) {
+            float *row = &depth[size_t(y) * OCCLUSION_WIDTH];
+#ifdef OCCLUSION_SSE2
+            const __m128 lanes = _mm_setr_ps(0, 1, 2, 3);
+            const __m128 zero = _mm_setzero_ps();
+            __m128 edge0 = _mm_add_ps(_mm_set1_ps(rowStart[0]), _mm_mul_ps(lanes, _mm_set1_ps(stepX[0])));
+            __m128 edge1 = _mm_add_ps(_mm_set1_ps(rowStart[1]), _mm_mul_ps(lanes, _mm_set1_ps(stepX[1])));
+            __m128 edge2 = _mm_add_ps(_mm_set1_ps(rowStart[2]), _mm_mul_ps(lanes, _mm_set1_ps(stepX[2])));
+            __m128 pixelDepth = _mm_add_ps(_mm_set1_ps(depthRowStart), _mm_mul_ps(lanes, _mm_set1_ps(depthStepX)));
+            const __m128 edge0Step = _mm_set1_ps(4 * stepX[0]);
+            const __m128 edge1Step = _mm_set1_ps(4 * stepX[1]);
+            const __m128 edge2Step = _mm_set1_ps(4 * stepX[2]);
+            const __m128 depthStep = _mm_set1_ps(4 * depthStepX);
+
+            for (int x = minX; x <= maxX; x += 4) {
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_cmpge_ps(edge1, zero)),
+                                           _mm_cmpge_ps(edge2, zero));
+                if (_mm_movemask_ps(inside) != 0) {
+                    __m128 stored = _mm_loadu_ps(row + x);
+                    __m128 nearer = _mm_min_ps(stored, pixelDepth);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, stored)));
+                }
+                edge0 = _mm_add_ps(edge0, edge0Step);
+                edge1 = _mm_add_ps(edge1, edge1Step);
+                edge2 = _mm_add_ps(edge2, edge2Step);
+                pixelDepth = _mm_add_ps(pixelDepth, depthStep);
+            }
+#else
+            for (int x = minX; x <= maxX; x++) {
+                int offset = x - minX;
+                if (rowStart[0] + offset * stepX[0] >= 0 && rowStart[1] + offset * stepX[1] >= 0 &&
+                    rowStart[2] + offset * stepX[2] >= 0) {
+                    row[x] = std::min(row[x], depthRowStart + offset * depthStepX);
+                }
+            }
+#endif
+            for (int edge = 0; edge < 3; edge++) {
+                rowStart[edge] += stepY[edge];
+            }
+            depthRowStart += depthStepY;
+        }
+    }
+}
+
+void OcclusionCuller::buildHierarchy() {
+    for (int level = 1; level < OCCLUSION_LEVELS; level++) {
+        const int width = OCCLUSION_WIDTH >> level;
+        const int height = OCCLUSION_HEIGHT >> level;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                float nearestDepth2x2 = 1;
+                float furthestDepth2x2 = 0;
+                for (int corner = 0; corner < 4; corner++) {
+                    int childX = 2 * x + (corner & 1);
+                    int childY = 2 * y + (corner >> 1);
+                    nearestDepth2x2 = std::min(nearestDepth2x2, nearest(level - 1, childX, childY));
+                    furthestDepth2x2 = std::max(furthestDepth2x2, furthest(level - 1, childX, childY));
+                }
+                nearestDepth[level][size_t(y) * width + x] = nearestDepth2x2;
+                furthestDepth[level][size_t(y) * width + x] = furthestDepth2x2;
+            }
+        }
+    }
+}
+
+float OcclusionCuller::nearest(int level, int x, int y) const {
+    return level == 0 ? depth[size_t(y) * OCCLUSION_WIDTH + x]
+                      : nearestDepth[level][size_t(y) * (OCCLUSION_WIDTH >> level) + x];
+}
+
+float OcclusionCuller::furthest(int level, int x, int y) const {
+    return level == 0 ? depth[size_t(y) * OCCLUSION_WIDTH + x]
+                      : furthestDepth[level][size_t(y) * (OCCLUSION_WIDTH >> level) + x];
+}
+
+bool OcclusionCuller::isOccluded(const glm::mat4 &mvp, const glm::vec3 &extent) const {
+    glm::vec2 minNDC(1e30f);
+    glm::vec2 maxNDC(-1e30f);
+    float nearestNDC = 1e30f;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec4 position((corner & 1) ? extent.x : -extent.x, (corner & 2) ? extent.y : -extent.y,
+                           (corner & 4) ? extent.z : -extent.z, 1);
+        glm::vec4 clip = mvp * position;
+        if (clip.z < -clip.w || clip.w <= 0) {
+            return false;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        minNDC = glm::min(minNDC, glm::vec2(ndc.x, ndc.y));
+        maxNDC = glm::max(maxNDC, glm::vec2(ndc.x, ndc.y));
+        nearestNDC = std::min(nearestNDC, ndc.z);
+    }
+    // Outside the view is for the GPU to clip; only occlusion is decided here
+    if (maxNDC.x < -1 || maxNDC.y < -1 || minNDC.x > 1 || minNDC.y > 1) {
+        return false;
+    }
+
+    const float nearestDepth = nearestNDC * 0.5f + 0.5f;
+    int x0 = std::max(0, int((minNDC.x * 0.5f + 0.5f) * OCCLUSION_WIDTH));
+    int y0 = std::max(0, int((minNDC.y * 0.5f + 0.5f) * OCCLUSION_HEIGHT));
+    int x1 = std::min(OCCLUSION_WIDTH - 1, int((maxNDC.x * 0.5f + 0.5f) * OCCLUSION_WIDTH));
+    int y1 = std::min(OCCLUSION_HEIGHT - 1, int((maxNDC.y * 0.5f + 0.5f) * OCCLUSION_HEIGHT));
+
+    // The level where the box covers at most two by two texels
+    int level = 0;
+    while (level + 1 < OCCLUSION_LEVELS && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+        level++;
+    }
+
+    // One level up, a single texel often settles it: the box is in front of everything
+    // there, or behind all of it
+    if (level + 1 < OCCLUSION_LEVELS && (x1 >> (level + 1)) == (x0 >> (level + 1)) &&
+        (y1 >> (level + 1)) == (y0 >> (level + 1))) {
+        int x = x0 >> (level + 1);
+        int y = y0 >> (level + 1);
+        if (nearestDepth <= nearest(level + 1, x, y)) {
+            return false;
+        }
+        if (nearestDepth >= furthest(level + 1, x, y)) {
+            return true;
+        }
+    }
+
+    for (int y = y0 >> level; y <= y1 >> level; y++) {
+        for (int x = x0 >> level; x <= x1 >> level; x++) {
+            if (nearestDepth < furthest(level, x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "mesh.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+// Resolution of the depth buffer occluders are rasterized into. The width must be a
+// multiple of 4, and both must stay divisible by 2 for every level of the hierarchy.
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_LEVELS 6
+// Rows per band; the bands are rasterized in parallel
+#define OCCLUSION_BAND_HEIGHT 16
+
+// Simplified geometry that hides what is behind it. Triangles are front facing when
+// counter-clockwise, like in GL, and only front faces occlude.
+struct OccluderMesh {
+    std::vector<glm::vec3> vertices;
+    std::vector<unsigned int> indices;
+};
+
+OccluderMesh makeOccluder(const Mesh &mesh);
+
+// Decides which objects are hidden behind the occluders, on the CPU. The occluders are
+// rasterized into a small depth buffer, four pixels at a time with SSE2 where available
+// and in bands on all cores. The buffer is then reduced into a hierarchy holding the
+// nearest and furthest depth of every block, so that testing a bounding volume only reads
+// a few texels at the level where it covers about two by two.
+//
+// Depths are GL window depths: 0 at the near plane and 1 at the far plane.
+class OcclusionCuller {
+  public:
+    OcclusionCuller();
+
+    void beginFrame();
+    // mvp transforms the occluder's vertices to clip space
+    void addOccluder(const OccluderMesh &occluder, const glm::mat4 &mvp);
+    // Rasterizes the occluders and builds the hierarchy
+    void endFrame();
+
+    // Whether the box from -extent to extent, transformed to clip space by mvp, is entirely
+    // hidden. Boxes that cross the near plane are never hidden.
+    bool isOccluded(const glm::mat4 &mvp, const glm::vec3 &extent) const;
+
+    size_t occluderTriangles() const { return triangles.size(); }
+
+    OcclusionCuller(OcclusionCuller const &) = delete;
+    OcclusionCuller &operator=(OcclusionCuller const &) = delete;
+
+  private:
+    // A triangle in pixel coordinates, with the window depth of each corner
+    struct ScreenTriangle {
+        glm::vec3 corners[3];
+    };
+
+    void clipAndAdd(const glm::vec4 *clip);
+    void addTriangle(const glm::vec4 &a, const glm::vec4 &b, const glm::vec4 &c);
+    void rasterizeBand(int firstRow, int endRow);
+    void buildHierarchy();
+    float nearest(int level, int x, int y) const;
+    float furthest(int level, int x, int y) const;
+
+    std::vector<ScreenTriangle> triangles;
+    std::vector<float> depth;
+    // Level n of the hierarchy is 2^n times smaller than the depth buffer on each axis, and
+    // holds the nearest and furthest depth of each block. Level 0 is the depth buffer itself.
+    std::vector<float> nearestDepth[OCCLUSION_LEVELS];
+    std::vector<float> furthestDepth[OCCLUSION_LEVELS];
+};
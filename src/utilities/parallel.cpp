@@ -0,0 +1,36 @@
+#include "parallel.h"
+#include "profiler.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+void parallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)> &body) {
+    size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, count / std::max<size_t>(minChunkSize, 1));
+
+    if (threadCount <= 1) {
+        body(0, count);
+        return;
+    }
+
+    size_t chunkSize = (count + threadCount - 1) / threadCount;
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+        size_t end = std::min(begin + chunkSize, count);
+        workers.emplace_back([&body, begin, end] {
+            PROFILE_THREAD_NAME("parallelFor worker");
+            PROFILE_ZONE("parallelFor chunk");
+            body(begin, end);
+        });
+    }
+    // The calling thread takes the first chunk itself
+    {
+        PROFILE_ZONE("parallelFor chunk");
+        body(0, std::min(chunkSize, count));
+    }
+
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
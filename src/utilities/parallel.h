@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// Splits [0, count) into one contiguous chunk per hardware thread and runs body(begin, end)
+// on each, returning once all chunks are done. Ranges shorter than two minimum chunks are
+// run on the calling thread.
+void parallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)> &body);
@@ -0,0 +1,157 @@
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct ProfileEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// One row in the trace. Written only by the thread that owns it. The count is published
+// with release ordering after each event, so a reader sees complete events only. The
+// first PROFILER_STARTUP_CAPACITY events go to startupEvents, and the rest to the ring.
+struct ProfileTrack {
+    std::unique_ptr<ProfileEvent[]> startupEvents{new ProfileEvent[PROFILER_STARTUP_CAPACITY]};
+    std::unique_ptr<ProfileEvent[]> events{new ProfileEvent[PROFILER_THREAD_CAPACITY]};
+    std::atomic<uint64_t> count{0};
+    std::atomic<bool> inUse{true};
+    const char *threadName = nullptr;
+    unsigned int threadID = 0;
+};
+
+static const std::chrono::steady_clock::time_point profilerStart = std::chrono::steady_clock::now();
+
+// Buffers are never freed. When a thread exits its buffer is handed to the next new
+// thread, so the short-lived workers of parallelFor share a few buffers rather than
+// growing the list without bound.
+static std::mutex bufferListMutex;
+static std::vector<std::unique_ptr<ProfileTrack>> bufferList;
+
+struct ThreadBufferHandle {
+    ProfileTrack *buffer = nullptr;
+
+    ~ThreadBufferHandle() {
+        if (buffer != nullptr) {
+            buffer->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+static thread_local ThreadBufferHandle threadBuffer;
+
+static ProfileTrack *acquireThreadBuffer() {
+    if (threadBuffer.buffer != nullptr) {
+        return threadBuffer.buffer;
+    }
+
+    // Only taken once per thread
+    std::lock_guard<std::mutex> lock(bufferListMutex);
+    for (auto &buffer : bufferList) {
+        bool expected = false;
+        if (buffer->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            threadBuffer.buffer = buffer.get();
+            return threadBuffer.buffer;
+        }
+    }
+    bufferList.emplace_back(new ProfileTrack());
+    bufferList.back()->threadID = unsigned(bufferList.size());
+    threadBuffer.buffer = bufferList.back().get();
+    return threadBuffer.buffer;
+}
+
+uint64_t profilerNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profilerStart)
+        .count();
+}
+
+void profilerRecord(const char *name, uint64_t startNanoseconds, uint64_t endNanoseconds) {
+    profilerRecordOnTrack(acquireThreadBuffer(), name, startNanoseconds, endNanoseconds);
+}
+
+ProfileTrack *profilerCreateTrack(const char *name) {
+    std::lock_guard<std::mutex> lock(bufferListMutex);
+    bufferList.emplace_back(new ProfileTrack());
+    bufferList.back()->threadID = unsigned(bufferList.size());
+    bufferList.back()->threadName = name;
+    return bufferList.back().get();
+}
+
+void profilerRecordOnTrack(ProfileTrack *track, const char *name, uint64_t startNanoseconds,
+                           uint64_t endNanoseconds) {
+    uint64_t count = track->count.load(std::memory_order_relaxed);
+    if (count < PROFILER_STARTUP_CAPACITY) {
+        track->startupEvents[count] = {name, startNanoseconds, endNanoseconds};
+    } else {
+        track->events[(count - PROFILER_STARTUP_CAPACITY) % PROFILER_THREAD_CAPACITY] = {name, startNanoseconds,
+                                                                                         endNanoseconds};
+    }
+    track->count.store(count + 1, std::memory_order_release);
+}
+
+void profilerSetThreadName(const char *name) {
+    acquireThreadBuffer()->threadName = name;
+}
+
+static void writeEscaped(FILE *file, const char *text) {
+    for (; *text != '\0'; text++) {
+        if (*text == '"' || *text == '\\') {
+            fputc('\\', file);
+        }
+        fputc(*text, file);
+    }
+}
+
+static void writeEvent(FILE *file, const ProfileEvent &event, unsigned int threadID, bool first) {
+    fprintf(file, "%s{\"name\":\"", first ? "" : ",\n");
+    writeEscaped(file, event.name);
+    fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", threadID, event.start / 1000.0,
+            (event.end - event.start) / 1000.0);
+}
+
+bool writeProfilerTrace(const std::string &fileName) {
+    FILE *file = fopen(fileName.c_str(), "w");
+    if (file == nullptr) {
+        fprintf(stderr, "Could not write trace to %s\n", fileName.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(bufferListMutex);
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    size_t eventCount = 0;
+    for (auto &buffer : bufferList) {
+        if (buffer->threadName != nullptr) {
+            fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+                    first ? "" : ",\n", buffer->threadID);
+            writeEscaped(file, buffer->threadName);
+            fprintf(file, "\"}}");
+            first = false;
+        }
+
+        // The startup events, then the newest PROFILER_THREAD_CAPACITY events still in the ring
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        uint64_t startupCount = std::min<uint64_t>(count, PROFILER_STARTUP_CAPACITY);
+        for (uint64_t i = 0; i < startupCount; i++) {
+            writeEvent(file, buffer->startupEvents[i], buffer->threadID, first);
+            first = false;
+        }
+        uint64_t ringCount = std::min<uint64_t>(count - startupCount, PROFILER_THREAD_CAPACITY);
+        for (uint64_t i = count - ringCount; i < count; i++) {
+            writeEvent(file, buffer->events[(i - PROFILER_STARTUP_CAPACITY) % PROFILER_THREAD_CAPACITY],
+                       buffer->threadID, first);
+            first = false;
+        }
+        eventCount += startupCount + ringCount;
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    printf("Wrote %zu profiler zones to %s\n", eventCount, fileName.c_str());
+    return true;
+}
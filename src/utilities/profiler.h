@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Number of zones each thread keeps; older zones are overwritten
+#define PROFILER_THREAD_CAPACITY 65536
+// The first zones of each thread are kept apart and never overwritten, so that the
+// trace shows startup however long the program ran before writing it
+#define PROFILER_STARTUP_CAPACITY 16384
+
+// PROFILE_ZONE("name") measures the rest of the enclosing scope. Zones nest, and are
+// recorded by the thread they ran on without taking any locks. The name must be a
+// string literal, as only the pointer is stored.
+//
+// GLOWBOX_PROFILING is defined for every configuration but Release; without it the
+// zones compile to nothing.
+#ifdef GLOWBOX_PROFILING
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCATENATE(profileZone, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) profilerSetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD_NAME(name)
+#endif
+
+// Nanoseconds since the profiler was started
+uint64_t profilerNow();
+
+// Records a zone that has already ended on the calling thread
+void profilerRecord(const char *name, uint64_t startNanoseconds, uint64_t endNanoseconds);
+
+// Names the calling thread in the trace
+void profilerSetThreadName(const char *name);
+
+// A row in the trace that is not tied to a thread, for zones measured elsewhere (such as
+// on the GPU). Each track must only be recorded to by one thread at a time.
+struct ProfileTrack;
+ProfileTrack *profilerCreateTrack(const char *name);
+void profilerRecordOnTrack(ProfileTrack *track, const char *name, uint64_t startNanoseconds,
+                           uint64_t endNanoseconds);
+
+// Writes all recorded zones in the Chrome trace event format, which can be opened in
+// chrome://tracing or ui.perfetto.dev. Call when no other thread is recording.
+bool writeProfilerTrace(const std::string &fileName);
+
+class ProfileZone {
+  public:
+    explicit ProfileZone(const char *name) : name(name), start(profilerNow()) {}
+    ~ProfileZone() { profilerRecord(name, start, profilerNow()); }
+
+    ProfileZone(ProfileZone const &) = delete;
+    ProfileZone &operator=(ProfileZone const &) = delete;
+
+  private:
+    const char *name;
+    uint64_t start;
+};
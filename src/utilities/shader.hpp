@@ -4,6 +4,7 @@
 
 // System headers
 #include <glad/glad.h>
+#include "profiler.h"
 
 // Standard headers
 #include <cassert>
@@ -39,6 +40,8 @@ namespace Gloom
         /* Attach a shader to the current shader program */
         void attach(std::string const &filename)
         {
+            PROFILE_ZONE("Shader::attach");
+
             // Load GLSL Shader from source
             std::ifstream fd(filename.c_str());
             if (fd.fail())
@@ -79,6 +82,8 @@ namespace Gloom
         /* Links all attached shaders together into a shader program */
         void link()
         {
+            PROFILE_ZONE("Shader::link");
+
             // Link all attached shaders
             glLinkProgram(mProgram);
 
@@ -106,6 +111,15 @@ namespace Gloom
             link();
         }
 
+        /* Replaces the program with another, linked one, and returns the
+           previous program without deleting it */
+        GLuint swap(GLuint program)
+        {
+            GLuint previous = mProgram;
+            mProgram = program;
+            return previous;
+        }
+
         /* Convenience function to get a uniforms ID from a string
            containing its name */
         GLint getUniformFromName(std::string const &uniformName) {
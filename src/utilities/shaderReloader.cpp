@@ -0,0 +1,161 @@
+#include "shaderReloader.h"
+#include "mappedFile.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+ShaderReloader::ShaderReloader() {
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        // Let the driver pick how many threads to compile on
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+}
+
+ShaderReloader::~ShaderReloader() {
+    for (Program &program : programs) {
+        for (GLuint stage : program.stages) {
+            glDeleteShader(stage);
+        }
+        if (program.pending != 0) {
+            glDeleteProgram(program.pending);
+        }
+    }
+    for (const Retired &old : retired) {
+        glDeleteProgram(old.program);
+    }
+}
+
+void ShaderReloader::add(Gloom::Shader &shader, const std::vector<std::string> &files,
+                         std::function<void()> onReload) {
+    Program program;
+    program.shader = &shader;
+    program.files = files;
+    program.onReload = std::move(onReload);
+    for (const std::string &file : files) {
+        watcher.watch(file);
+    }
+    programs.push_back(std::move(program));
+}
+
+void ShaderReloader::update(uint64_t frame) {
+    PROFILE_ZONE("ShaderReloader::update");
+
+    auto expired = std::partition(retired.begin(), retired.end(), [frame](const Retired &old) {
+        return old.frame + SHADER_RETIRE_FRAMES > frame;
+    });
+    for (auto old = expired; old != retired.end(); ++old) {
+        glDeleteProgram(old->program);
+    }
+    retired.erase(expired, retired.end());
+
+    changedFiles.clear();
+    watcher.poll(changedFiles);
+    for (Program &program : programs) {
+        for (const std::string &file : changedFiles) {
+            if (std::find(program.files.begin(), program.files.end(), file) != program.files.end()) {
+                program.changed = true;
+            }
+        }
+
+        if (program.pending != 0 && isFinished(program, frame)) {
+            finishReload(program, frame);
+        }
+        // Saving again while compiling starts over once the older version is done
+        if (program.pending == 0 && program.changed) {
+            program.changed = false;
+            startReload(program, frame);
+        }
+    }
+}
+
+void ShaderReloader::startReload(Program &program, uint64_t frame) {
+    GLuint pending = glCreateProgram();
+    for (const std::string &file : program.files) {
+        MappedFile source(file);
+        if (!source.isOpen()) {
+            fprintf(stderr, "Could not reload %s; keeping the previous shader\n", file.c_str());
+            for (GLuint stage : program.stages) {
+                glDeleteShader(stage);
+            }
+            program.stages.clear();
+            glDeleteProgram(pending);
+            return;
+        }
+
+        // Neither compiling nor linking waits for the result; only asking for it does
+        GLuint stage = program.shader->create(file);
+        const GLchar *text = source.data();
+        GLint length = GLint(source.size());
+        glShaderSource(stage, 1, &text, &length);
+        glCompileShader(stage);
+        glAttachShader(pending, stage);
+        program.stages.push_back(stage);
+    }
+    glLinkProgram(pending);
+
+    program.pending = pending;
+    program.startFrame = frame;
+}
+
+bool ShaderReloader::isFinished(const Program &program, uint64_t frame) const {
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+        GLint completed = GL_FALSE;
+        glGetProgramiv(program.pending, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
+    return frame > program.startFrame;
+}
+
+// Prints the info log of a shader or program
+static void printLog(GLuint object, bool isProgram) {
+    GLint length = 0;
+    if (isProgram) {
+        glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+    } else {
+        glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+    }
+    if (length <= 1) {
+        return;
+    }
+    std::unique_ptr<char[]> buffer(new char[length]);
+    if (isProgram) {
+        glGetProgramInfoLog(object, length, nullptr, buffer.get());
+    } else {
+        glGetShaderInfoLog(object, length, nullptr, buffer.get());
+    }
+    fprintf(stderr, "%s\n", buffer.get());
+}
+
+void ShaderReloader::finishReload(Program &program, uint64_t frame) {
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program.pending, GL_LINK_STATUS, &linked);
+    if (linked == GL_TRUE) {
+        retired.push_back({program.shader->swap(program.pending), frame});
+        program.onReload();
+        std::string names;
+        for (const std::string &file : program.files) {
+            names += (names.empty() ? "" : ", ") + file;
+        }
+        printf("Reloaded %s\n", names.c_str());
+    } else {
+        for (size_t i = 0; i < program.stages.size(); i++) {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(program.stages[i], GL_COMPILE_STATUS, &compiled);
+            if (compiled != GL_TRUE) {
+                fprintf(stderr, "%s\n", program.files[i].c_str());
+                printLog(program.stages[i], false);
+            }
+        }
+        printLog(program.pending, true);
+        fprintf(stderr, "Keeping the previous shader\n");
+        glDeleteProgram(program.pending);
+    }
+
+    // The linked program keeps what it needs of its shaders
+    for (GLuint stage : program.stages) {
+        glDeleteShader(stage);
+    }
+    program.stages.clear();
+    program.pending = 0;
+}
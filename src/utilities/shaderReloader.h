@@ -0,0 +1,66 @@
+#pragma once
+
+#include "fileWatcher.h"
+#include "framePipeline.h"
+#include "shader.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Frames a replaced program is kept for. Commands recorded with it may still be in the
+// pipeline, or being recorded, when it is replaced.
+#define SHADER_RETIRE_FRAMES (FRAME_PIPELINE_SLOTS + 2)
+
+// Relinks shaders while the program runs, whenever one of their source files is saved.
+// The new program is compiled and linked next to the one in use, and only replaces it
+// once it has linked; a shader that fails to compile prints its log and leaves the old
+// program running.
+//
+// With GL_KHR_parallel_shader_compile the driver compiles on its own threads, and the
+// reloader polls for completion every frame, so a reload never stalls a frame. Without
+// it, the status is checked the frame after compiling, where the driver may still have
+// to finish the work.
+class ShaderReloader {
+  public:
+    ShaderReloader();
+    ~ShaderReloader();
+
+    // files are the sources shader was made from. onReload is called after the swap, to
+    // look up uniforms again and set the ones that are not set every frame.
+    void add(Gloom::Shader &shader, const std::vector<std::string> &files, std::function<void()> onReload);
+
+    // Checks for saved files, starts and finishes reloads, and deletes programs that were
+    // replaced SHADER_RETIRE_FRAMES ago. Must be called on the thread with the GL context,
+    // before drawing the snapshot of frame.
+    void update(uint64_t frame);
+
+    ShaderReloader(ShaderReloader const &) = delete;
+    ShaderReloader &operator=(ShaderReloader const &) = delete;
+
+  private:
+    struct Program {
+        Gloom::Shader *shader;
+        std::vector<std::string> files;
+        std::function<void()> onReload;
+        bool changed = false;
+        // The program being compiled and linked, and its shaders, or 0
+        GLuint pending = 0;
+        std::vector<GLuint> stages;
+        uint64_t startFrame = 0;
+    };
+
+    struct Retired {
+        GLuint program;
+        uint64_t frame;
+    };
+
+    void startReload(Program &program, uint64_t frame);
+    bool isFinished(const Program &program, uint64_t frame) const;
+    void finishReload(Program &program, uint64_t frame);
+
+    FileWatcher watcher;
+    std::vector<Program> programs;
+    std::vector<Retired> retired;
+    std::vector<std::string> changedFiles;
+};
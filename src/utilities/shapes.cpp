@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include "shapes.h"
 
@@ -205,3 +206,131 @@ Mesh generateSphere(float sphereRadius, int slices, int layers) {
     mesh.textureCoordinates = uvs;
     return mesh;
 }
+
+// Width (in slices) of the column blocks the indexed sphere emits its triangles in.
+// Two rows of a block have to fit in the post-transform vertex cache for every
+// vertex to be reused, and 2 * (8 + 1) = 18 is below the size of any current cache.
+#define SPHERE_CACHE_BLOCK_WIDTH 8
+
+// Builds one tessellation level of the indexed sphere from precomputed sine and cosine
+// tables. The tables hold the finest level; `step` selects every n-th entry of them.
+static Mesh buildIndexedSphere(float sphereRadius, int slices, int layers, int step,
+                               const std::vector<float> &layerSin, const std::vector<float> &layerCos,
+                               const std::vector<float> &sliceSin, const std::vector<float> &sliceCos) {
+    const int columns = slices + 1;
+    auto gridIndex = [columns](int layer, int slice) { return unsigned(layer * columns + slice); };
+
+    // The grid has an extra column so the vertices along the texture seam can have
+    // u = 0 and u = 1. The poles are duplicated per slice for the same reason.
+    std::vector<glm::vec3> gridNormals((layers + 1) * columns);
+    std::vector<glm::vec2> gridUVs((layers + 1) * columns);
+    for (int layer = 0; layer <= layers; layer++) {
+        float radius = layerSin[layer * step];
+        float z = -layerCos[layer * step];
+        bool isPole = layer == 0 || layer == layers;
+
+        for (int slice = 0; slice <= slices; slice++) {
+            gridNormals[gridIndex(layer, slice)] =
+                glm::vec3(radius * sliceCos[slice * step], radius * sliceSin[slice * step], z);
+            // Centre the pole vertices on the slice they close, so the texture does not shear at the poles
+            float u = (isPole && slice < slices ? slice + 0.5f : float(slice)) / slices;
+            gridUVs[gridIndex(layer, slice)] = glm::vec2(u, float(layer) / layers);
+        }
+    }
+
+    // Emit triangles in column blocks, sweeping all layers of a block before moving
+    // on to the next, which keeps the previous row of the block in the vertex cache.
+    // Triangles that collapse into a pole are skipped.
+    std::vector<unsigned int> gridIndices;
+    gridIndices.reserve(slices * (layers - 1) * 6);
+    for (int blockStart = 0; blockStart < slices; blockStart += SPHERE_CACHE_BLOCK_WIDTH) {
+        int blockEnd = std::min(blockStart + SPHERE_CACHE_BLOCK_WIDTH, slices);
+        for (int layer = 0; layer < layers; layer++) {
+            for (int slice = blockStart; slice < blockEnd; slice++) {
+                unsigned int current = gridIndex(layer, slice);
+                unsigned int currentNext = gridIndex(layer, slice + 1);
+                unsigned int above = gridIndex(layer + 1, slice);
+                unsigned int aboveNext = gridIndex(layer + 1, slice + 1);
+
+                if (layer != 0) {
+                    gridIndices.insert(gridIndices.end(), {current, currentNext, aboveNext});
+                }
+                if (layer != layers - 1) {
+                    gridIndices.insert(gridIndices.end(), {current, aboveNext, above});
+                }
+            }
+        }
+    }
+
+    // Store the vertices in the order they are first referenced, so fetching them is
+    // as linear as the index buffer allows. Unreferenced pole duplicates are dropped.
+    const unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(gridNormals.size(), unused);
+
+    Mesh mesh;
+    mesh.vertices.reserve(gridNormals.size());
+    mesh.normals.reserve(gridNormals.size());
+    mesh.textureCoordinates.reserve(gridNormals.size());
+    mesh.indices.reserve(gridIndices.size());
+
+    for (unsigned int index : gridIndices) {
+        if (remap[index] == unused) {
+            remap[index] = mesh.vertices.size();
+            mesh.vertices.push_back(gridNormals[index] * sphereRadius);
+            mesh.normals.push_back(gridNormals[index]);
+            mesh.textureCoordinates.push_back(gridUVs[index]);
+        }
+        mesh.indices.push_back(remap[index]);
+    }
+
+    return mesh;
+}
+
+// Generates a chain of indexed spheres, where every level has half the slices and
+// layers of the previous one. The sine and cosine tables are computed once for the
+// finest level and shared by the others. The chain stops early once a level can
+// no longer be halved evenly or would become too coarse to be a sphere.
+std::vector<Mesh> generateSphereLODs(float sphereRadius, int slices, int layers, int levels) {
+    std::vector<float> layerSin(layers + 1), layerCos(layers + 1);
+    std::vector<float> sliceSin(slices + 1), sliceCos(slices + 1);
+
+    for (int layer = 0; layer <= layers; layer++) {
+        float angle = M_PI * float(layer) / float(layers);
+        layerSin[layer] = sin(angle);
+        layerCos[layer] = cos(angle);
+    }
+    for (int slice = 0; slice < slices; slice++) {
+        float angle = 2 * M_PI * float(slice) / float(slices);
+        sliceSin[slice] = sin(angle);
+        sliceCos[slice] = cos(angle);
+    }
+    // Close the seam exactly, so it cannot crack
+    sliceSin[slices] = sliceSin[0];
+    sliceCos[slices] = sliceCos[0];
+    // Likewise make the poles exact
+    layerSin[0] = layerSin[layers] = 0;
+
+    std::vector<Mesh> lods;
+    int step = 1;
+    for (int level = 0; level < levels; level++) {
+        lods.push_back(
+            buildIndexedSphere(sphereRadius, slices / step, layers / step, step, layerSin, layerCos, sliceSin, sliceCos));
+
+        step *= 2;
+        if (slices % step != 0 || layers % step != 0 || slices / step < 4 || layers / step < 2) {
+            break;
+        }
+    }
+    return lods;
+}
+
+// Measured at the midpoint of the longest edge. Edges along a layer span at most
+// 2 pi / slices radians, and edges between layers pi / layers.
+float sphereTessellationError(float sphereRadius, int slices, int layers) {
+    float halfAngle = std::max(M_PI / float(slices), M_PI / float(2 * layers));
+    return sphereRadius * (1 - cos(halfAngle));
+}
+
+Mesh generateIndexedSphere(float sphereRadius, int slices, int layers) {
+    return generateSphereLODs(sphereRadius, slices, layers, 1).front();
+}
@@ -3,4 +3,8 @@
 
 Mesh cube(glm::vec3 scale = glm::vec3(1), glm::vec2 textureScale = glm::vec2(1), bool tilingTextures = false, bool inverted = false, glm::vec3 textureScale3d = glm::vec3(1));
 Mesh generateBox(float width, float height, float depth, bool flipFaces = false);
-Mesh generateSphere(float radius, int slices, int layers);
\ No newline at end of file
+Mesh generateSphere(float radius, int slices, int layers);
+Mesh generateIndexedSphere(float radius, int slices, int layers);
+std::vector<Mesh> generateSphereLODs(float radius, int slices, int layers, int levels);
+// Largest distance between a sphere and its tessellation with this many slices and layers
+float sphereTessellationError(float radius, int slices, int layers);
\ No newline at end of file
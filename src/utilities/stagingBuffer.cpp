@@ -0,0 +1,58 @@
+#include "stagingBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+StagingBuffer::StagingBuffer(size_t bytesPerFrame) : bytesPerFrame(bytesPerFrame) {
+    GLsizeiptr bufferSize = GLsizeiptr(bytesPerFrame * STAGING_RING_FRAMES);
+    GLbitfield mapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &bufferID);
+    glNamedBufferStorage(bufferID, bufferSize, nullptr, mapFlags);
+    mappedBytes = static_cast<unsigned char *>(glMapNamedBufferRange(bufferID, 0, bufferSize, mapFlags));
+}
+
+StagingBuffer::~StagingBuffer() {
+    for (GLsync fence : frameFences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+        }
+    }
+    glUnmapNamedBuffer(bufferID);
+    glDeleteBuffers(1, &bufferID);
+}
+
+bool StagingBuffer::beginFrame() {
+    frameIndex = (frameIndex + 1) % STAGING_RING_FRAMES;
+    frameBytes = 0;
+
+    GLsync &fence = frameFences[frameIndex];
+    if (fence != nullptr) {
+        // A zero timeout only polls. The region is tried again when the ring comes back to it.
+        if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+            available = false;
+            return false;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    available = true;
+    return true;
+}
+
+size_t StagingBuffer::upload(GLuint buffer, GLintptr offset, const void *data, size_t size) {
+    size = std::min(size, bytesLeft());
+    if (size == 0) {
+        return 0;
+    }
+    size_t stagingOffset = frameIndex * bytesPerFrame + frameBytes;
+    std::memcpy(mappedBytes + stagingOffset, data, size);
+    glCopyNamedBufferSubData(bufferID, buffer, GLintptr(stagingOffset), offset, GLsizeiptr(size));
+    frameBytes += size;
+    return size;
+}
+
+void StagingBuffer::endFrame() {
+    if (available && frameBytes > 0) {
+        frameFences[frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    available = false;
+}
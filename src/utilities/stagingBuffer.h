@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+
+// Number of frames of uploads that may be in flight before their part of the ring is reused
+#define STAGING_RING_FRAMES 3
+
+// Uploads data to buffers through a persistently mapped ring, split into one region
+// per frame. The data is copied into the mapping and then to its destination with
+// glCopyNamedBufferSubData, so the driver never has to stall for a buffer in use or
+// keep its own copy of the data. A fence guards every region: instead of waiting for
+// the GPU, beginFrame reports when the region is still being read, and nothing is
+// uploaded that frame.
+class StagingBuffer {
+  public:
+    explicit StagingBuffer(size_t bytesPerFrame);
+    ~StagingBuffer();
+
+    // Moves to the next region. Returns false if the GPU has not finished with it yet.
+    bool beginFrame();
+    // Copies up to size bytes to buffer at offset, returning how many fit in what is left
+    // of the frame's region
+    size_t upload(GLuint buffer, GLintptr offset, const void *data, size_t size);
+    // Fences the uploads made since beginFrame
+    void endFrame();
+
+    size_t bytesLeft() const { return available ? bytesPerFrame - frameBytes : 0; }
+
+    StagingBuffer(StagingBuffer const &) = delete;
+    StagingBuffer &operator=(StagingBuffer const &) = delete;
+
+  private:
+    GLuint bufferID;
+    unsigned char *mappedBytes;
+    GLsync frameFences[STAGING_RING_FRAMES] = {};
+
+    size_t bytesPerFrame;
+    unsigned int frameIndex = 0;
+    size_t frameBytes = 0;
+    bool available = false;
+};
@@ -0,0 +1,97 @@
+#include "tangents.h"
+#include "meshOptimizer.h"
+#include "parallel.h"
+#include <cmath>
+
+// Below this many triangles or vertices per thread, spreading out costs more than it gains
+#define TANGENT_MIN_CHUNK_SIZE 16384
+
+// Unnormalized tangent and bitangent of every triangle, following the UV gradients
+static void generateTriangleTangents(const Mesh &mesh, std::vector<glm::vec3> &tangents,
+                                     std::vector<glm::vec3> &bitangents, size_t begin, size_t end) {
+    for (size_t triangle = begin; triangle < end; triangle++) {
+        unsigned int i0 = mesh.indices[3 * triangle + 0];
+        unsigned int i1 = mesh.indices[3 * triangle + 1];
+        unsigned int i2 = mesh.indices[3 * triangle + 2];
+
+        glm::vec3 deltaPos1 = mesh.vertices[i1] - mesh.vertices[i0];
+        glm::vec3 deltaPos2 = mesh.vertices[i2] - mesh.vertices[i0];
+
+        glm::vec2 deltaUv1 = mesh.textureCoordinates[i1] - mesh.textureCoordinates[i0];
+        glm::vec2 deltaUv2 = mesh.textureCoordinates[i2] - mesh.textureCoordinates[i0];
+
+        float determinant = deltaUv1.x * deltaUv2.y - deltaUv1.y * deltaUv2.x;
+        if (determinant == 0.0f) {
+            // Degenerate UVs, the triangle has no usable tangent space
+            tangents[triangle] = glm::vec3(0);
+            bitangents[triangle] = glm::vec3(0);
+            continue;
+        }
+        // Only the direction matters, the corner angles provide the weighting
+        float sign = determinant < 0.0f ? -1.0f : 1.0f;
+        tangents[triangle] = (deltaPos1 * deltaUv2.y - deltaPos2 * deltaUv1.y) * sign;
+        bitangents[triangle] = (deltaPos2 * deltaUv1.x - deltaPos1 * deltaUv2.x) * sign;
+    }
+}
+
+// Component of v perpendicular to the unit vector normal, normalized (or zero)
+static glm::vec3 projectOntoPlane(glm::vec3 v, glm::vec3 normal) {
+    glm::vec3 projected = v - normal * glm::dot(normal, v);
+    float length = glm::length(projected);
+    return length > 0.0f ? projected / length : glm::vec3(0);
+}
+
+static float cornerAngle(const Mesh &mesh, unsigned int triangle, unsigned int vertex) {
+    unsigned int corner = 0;
+    while (mesh.indices[3 * triangle + corner] != vertex) {
+        corner++;
+    }
+    glm::vec3 position = mesh.vertices[vertex];
+    glm::vec3 toNext = mesh.vertices[mesh.indices[3 * triangle + (corner + 1) % 3]] - position;
+    glm::vec3 toPrevious = mesh.vertices[mesh.indices[3 * triangle + (corner + 2) % 3]] - position;
+
+    float lengths = glm::length(toNext) * glm::length(toPrevious);
+    if (lengths == 0.0f) {
+        return 0.0f;
+    }
+    return std::acos(glm::clamp(glm::dot(toNext, toPrevious) / lengths, -1.0f, 1.0f));
+}
+
+void generateTangents(Mesh &mesh) {
+    const size_t vertexCount = mesh.vertices.size();
+    const size_t triangleCount = mesh.indices.size() / 3;
+
+    std::vector<glm::vec3> triangleTangents(triangleCount);
+    std::vector<glm::vec3> triangleBitangents(triangleCount);
+    parallelFor(triangleCount, TANGENT_MIN_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        generateTriangleTangents(mesh, triangleTangents, triangleBitangents, begin, end);
+    });
+
+    // Every vertex gathers from its own triangles, so vertices can be handled in
+    // parallel without any two threads writing to the same tangent
+    VertexAdjacency adjacency = buildAdjacency(mesh.indices, vertexCount);
+    mesh.tangents.assign(vertexCount, glm::vec4(0));
+
+    parallelFor(vertexCount, TANGENT_MIN_CHUNK_SIZE, [&](size_t begin, size_t end) {
+        for (size_t vertex = begin; vertex < end; vertex++) {
+            glm::vec3 normal = mesh.normals[vertex];
+            glm::vec3 tangent(0);
+            glm::vec3 bitangent(0);
+
+            for (unsigned int a = adjacency.offsets[vertex]; a < adjacency.offsets[vertex + 1]; a++) {
+                unsigned int triangle = adjacency.triangles[a];
+                float weight = cornerAngle(mesh, triangle, vertex);
+                tangent += projectOntoPlane(triangleTangents[triangle], normal) * weight;
+                bitangent += projectOntoPlane(triangleBitangents[triangle], normal) * weight;
+            }
+
+            // Orthonormalize against the normal, and keep the bitangent as a sign only
+            tangent = projectOntoPlane(tangent, normal);
+            if (tangent == glm::vec3(0)) {
+                continue;
+            }
+            float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+            mesh.tangents[vertex] = glm::vec4(tangent, handedness);
+        }
+    });
+}
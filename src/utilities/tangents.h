@@ -0,0 +1,13 @@
+#pragma once
+
+#include "mesh.h"
+
+// Fills mesh.tangents with one tangent per vertex, with the sign of the bitangent
+// (cross(normal, tangent) * w) in w. Needs unit normals, texture coordinates and indices.
+//
+// Follows the approach of MikkTSpace: the tangent of every triangle is projected onto
+// the plane of each of its vertex normals and weighted by the triangle's angle at that
+// corner, so the result does not depend on how a surface is triangulated. Large meshes
+// are processed on all cores. Writes mesh.tangents and changes nothing else, so it can
+// run ahead of time and the result can be stored alongside the mesh.
+void generateTangents(Mesh &mesh);
@@ -0,0 +1,64 @@
+#include "threadPool.h"
+#include "profiler.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount, const char *threadName) : threadName(threadName) {
+    if (threadCount == 0) {
+        threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+size_t ThreadPool::pendingTasks() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.size() + runningTasks;
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    taskFinished.wait(lock, [this] { return tasks.empty() && runningTasks == 0; });
+}
+
+void ThreadPool::workerLoop() {
+    PROFILE_THREAD_NAME(threadName);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+            return;
+        }
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop_front();
+        runningTasks++;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        runningTasks--;
+        taskFinished.notify_all();
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads running queued tasks in submission order. Unlike
+// parallelFor the threads are kept alive, so it suits a steady stream of background
+// work. Queued tasks are finished before the destructor returns.
+class ThreadPool {
+  public:
+    // With threadCount 0, one thread is started per hardware thread but the calling one
+    ThreadPool(unsigned int threadCount, const char *threadName);
+    ~ThreadPool();
+
+    void submit(std::function<void()> task);
+    // Tasks that are queued or running
+    size_t pendingTasks();
+    // Waits until every submitted task has finished
+    void wait();
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+  private:
+    void workerLoop();
+
+    const char *threadName;
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    size_t runningTasks = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable taskFinished;
+};
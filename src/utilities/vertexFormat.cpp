@@ -0,0 +1,10 @@
+#include "vertexFormat.h"
+#include <glm/gtc/packing.hpp>
+
+PackedNormal packNormal(glm::vec4 normal) {
+    return {glm::packSnorm3x10_1x2(normal)};
+}
+
+HalfVec2 packHalf(glm::vec2 value) {
+    return {glm::packHalf2x16(value)};
+}
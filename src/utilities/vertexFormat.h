@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// A unit vector stored as GL_INT_2_10_10_10_REV: three signed normalized 10 bit
+// components, plus a 2 bit w that is -1, 0 or 1.
+struct PackedNormal {
+    uint32_t value;
+};
+
+// Two half floats (GL_HALF_FLOAT)
+struct HalfVec2 {
+    uint32_t value;
+};
+
+PackedNormal packNormal(glm::vec4 normal);
+HalfVec2 packHalf(glm::vec2 value);
+
+// The vertex format shared by every mesh uploaded through generateBuffer. 24 bytes,
+// compared to 56 for the five separate float arrays it replaces.
+struct PackedVertex {
+    glm::vec3 position;
+    PackedNormal normal;
+    // Tangent in xyz, with the sign of the bitangent (cross(normal, tangent) * w) in w
+    PackedNormal tangent;
+    HalfVec2 textureCoordinates;
+};
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex must be tightly packed");
+
+// How a member type is passed to glVertexAttribPointer
+template <class T> struct AttributeFormat;
+
+template <> struct AttributeFormat<glm::vec3> {
+    static constexpr GLint components = 3;
+    static constexpr GLenum type = GL_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+};
+
+template <> struct AttributeFormat<PackedNormal> {
+    static constexpr GLint components = 4;
+    static constexpr GLenum type = GL_INT_2_10_10_10_REV;
+    static constexpr GLboolean normalized = GL_TRUE;
+};
+
+template <> struct AttributeFormat<HalfVec2> {
+    static constexpr GLint components = 2;
+    static constexpr GLenum type = GL_HALF_FLOAT;
+    static constexpr GLboolean normalized = GL_FALSE;
+};
+
+// One attribute of an interleaved vertex: the shader location it feeds, and the
+// type and offset of the struct member it is read from
+template <GLuint location, class Member, size_t offset> struct VertexAttribute {
+    static void setup(GLsizei stride) {
+        glVertexAttribPointer(location, AttributeFormat<Member>::components, AttributeFormat<Member>::type,
+                              AttributeFormat<Member>::normalized, stride, reinterpret_cast<const void *>(offset));
+        glEnableVertexAttribArray(location);
+    }
+};
+
+#define VERTEX_ATTRIBUTE(Vertex, location, member)                                                                     \
+    VertexAttribute<location, decltype(Vertex::member), offsetof(Vertex, member)>
+
+template <class... Attributes> struct VertexAttributeList {
+    static void setup(GLsizei stride) {
+        int expand[] = {0, (Attributes::setup(stride), 0)...};
+        (void)expand;
+    }
+};
+
+// Specialised for every vertex struct, listing its attributes
+template <class Vertex> struct VertexLayout;
+
+template <> struct VertexLayout<PackedVertex> {
+    using Attributes = VertexAttributeList<VERTEX_ATTRIBUTE(PackedVertex, 0, position),
+                                           VERTEX_ATTRIBUTE(PackedVertex, 1, normal),
+                                           VERTEX_ATTRIBUTE(PackedVertex, 2, textureCoordinates),
+                                           VERTEX_ATTRIBUTE(PackedVertex, 3, tangent)>;
+};
+
+// Sets up the attribute pointers of the bound VAO for the vertex buffer bound to GL_ARRAY_BUFFER
+template <class Vertex> void setupVertexAttributes() {
+    VertexLayout<Vertex>::Attributes::setup(sizeof(Vertex));
+}
@@ -16,4 +16,28 @@ const int         windowSamples   = 4;
 struct CommandLineOptions {
     bool enableMusic;
     bool enableAutoplay;
+    // Frame rate limit, 0 for none
+    int maxFps;
+    bool vsync;
+    // Frames the simulation may run ahead of rendering on its own thread. 0 runs both on
+    // the main thread, one after the other, for the lowest latency.
+    int pipelineFrames;
+    // Where to write the profiler trace on exit; empty to not write one
+    std::string traceFile;
+    // Where to record the input and frame times of the session, and a recording to
+    // replay without a window instead of playing; empty for neither
+    std::string recordFile;
+    std::string replayFile;
+    // Where to save every frame as an image, empty to not capture; "qoi" or "png"
+    std::string captureDirectory;
+    std::string captureFormat;
+    // Size of the captured frames, which are drawn at this size whatever the window's
+    int captureWidth;
+    int captureHeight;
+    // Hide the window, and create the context without a display server where GLFW supports it
+    bool headless;
+    // Frames to run before exiting, 0 to run until the window is closed
+    int frameLimit;
+    // Directory of a level to stream in around the camera, empty for none
+    std::string levelDirectory;
 };
\ No newline at end of file
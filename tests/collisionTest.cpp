@@ -0,0 +1,56 @@
+#include "test.h"
+#include <utilities/collision.h>
+
+static bool near(const glm::vec3 &a, const glm::vec3 &b) {
+    return glm::length(a - b) < 1e-3f;
+}
+
+static bool inside(const glm::vec3 &centre, float radius, const AABB &box) {
+    for (int axis = 0; axis < 3; axis++) {
+        if (centre[axis] < box.min[axis] + radius || centre[axis] > box.max[axis] - radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TESTS {
+    const AABB box = {glm::vec3(0), glm::vec3(10)};
+    const float radius = 1;
+
+    registerTest("moveSphereInsideAABB bounces off corners more than once", [=] {
+        // Straight at the corner, which it reaches after 0.4 s, and at the opposite corner
+        // after 1.2 s. Both walls of a corner count as one bounce.
+        glm::vec3 centre(5, 5, 5);
+        glm::vec3 velocity(10, 0, 10);
+        int bounces = moveSphereInsideAABB(centre, velocity, radius, 1.6f, box, 16);
+        CHECK(bounces == 2);
+        CHECK(near(centre, glm::vec3(5, 5, 5)));
+        CHECK(velocity == glm::vec3(10, 0, 10));
+    });
+
+    registerTest("moveSphereInsideAABB crosses the box many times in one step", [=] {
+        // 100 units in a span of 8: 7 to the first wall, then 11 crossings and 5 more
+        glm::vec3 centre(2, 5, 5);
+        glm::vec3 velocity(100, 0, 0);
+        int bounces = moveSphereInsideAABB(centre, velocity, radius, 1.0f, box, 16);
+        CHECK(bounces == 12);
+        CHECK(near(centre, glm::vec3(6, 5, 5)));
+        CHECK(velocity == glm::vec3(100, 0, 0));
+    });
+
+    registerTest("moveSphereInsideAABB stays inside after running out of bounces", [=] {
+        glm::vec3 centre(2, 5, 5);
+        glm::vec3 velocity(100, 0, 30);
+        int bounces = moveSphereInsideAABB(centre, velocity, radius, 1.0f, box, 4);
+        CHECK(bounces == 4);
+        CHECK(inside(centre, radius, box));
+    });
+
+    registerTest("pointOverAABB allows only the margin past the edges", [=] {
+        CHECK(pointOverAABB(glm::vec3(5, 20, 5), box, 0.01f));
+        CHECK(pointOverAABB(glm::vec3(10.005f, 11, 5), box, 0.01f));
+        CHECK(!pointOverAABB(glm::vec3(10.02f, 11, 5), box, 0.01f));
+        CHECK(!pointOverAABB(glm::vec3(5, 11, -0.02f), box, 0.01f));
+    });
+}
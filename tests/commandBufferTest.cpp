@@ -0,0 +1,60 @@
+#include "test.h"
+#include <cstring>
+#include <utilities/commandBuffer.h>
+#include <vector>
+
+// The values of the uniforms recorded at location, in order
+template <class Value> static std::vector<Value> uniformValues(const CommandBuffer &buffer, GLint location) {
+    std::vector<Value> values;
+    for (size_t offset = 0; offset < buffer.size();) {
+        const unsigned char *command = buffer.data() + offset;
+        CommandHeader header;
+        std::memcpy(&header, command, sizeof(CommandHeader));
+        if (header.type == CommandType::SetUniform) {
+            SetUniformCommand uniform;
+            std::memcpy(&uniform, command + sizeof(CommandHeader), sizeof(SetUniformCommand));
+            if (uniform.location == location) {
+                Value value;
+                std::memcpy(&value, command + sizeof(CommandHeader) + sizeof(SetUniformCommand), sizeof(Value));
+                values.push_back(value);
+            }
+        }
+        offset += header.size;
+    }
+    return values;
+}
+
+TESTS {
+    registerTest("CommandBuffer patches only the uniforms at the location", [] {
+        glm::mat4 first(2);
+        glm::mat4 second(3);
+        glm::mat4 model(5);
+        CommandBuffer commands;
+        commands.setUniform(3, first);
+        commands.setUniform(4, model);
+        commands.setUniform(7, glm::vec3(1, 2, 3));
+        commands.drawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
+        commands.setUniform(3, second);
+        commands.drawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, 0);
+        size_t size = commands.size();
+
+        glm::mat4 camera(7);
+        commands.premultiplyUniforms(3, camera);
+        commands.replaceUniforms(7, glm::vec3(4, 5, 6));
+
+        CHECK(commands.size() == size);
+        std::vector<glm::mat4> mvps = uniformValues<glm::mat4>(commands, 3);
+        CHECK(mvps.size() == 2);
+        CHECK(mvps[0] == camera * first);
+        CHECK(mvps[1] == camera * second);
+        CHECK(uniformValues<glm::mat4>(commands, 4)[0] == model);
+        CHECK(uniformValues<glm::vec3>(commands, 7)[0] == glm::vec3(4, 5, 6));
+    });
+
+    registerTest("CommandBuffer patches only uniforms of the same type", [] {
+        CommandBuffer commands;
+        commands.setUniform(3, glm::vec3(1, 2, 3));
+        commands.premultiplyUniforms(3, glm::mat4(2));
+        CHECK(uniformValues<glm::vec3>(commands, 3)[0] == glm::vec3(1, 2, 3));
+    });
+}
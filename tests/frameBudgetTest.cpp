@@ -0,0 +1,55 @@
+#include "test.h"
+#include <chrono>
+#include <utilities/frameBudget.h>
+
+// Spins for the given time, like a GL call that takes that long
+static void spin(double milliseconds) {
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() <
+           milliseconds) {
+    }
+}
+
+TESTS {
+    registerTest("StepCost rises at once and falls slowly", [] {
+        StepCost cost;
+        cost.add(2);
+        CHECK(cost.milliseconds == 2);
+        cost.add(1);
+        CHECK(cost.milliseconds == 1.75);
+        cost.add(4);
+        CHECK(cost.milliseconds == 4);
+    });
+
+    registerTest("FrameBudget skips steps that do not fit", [] {
+        // Steps of at least 0.3 ms: a fourth would end after 1.2 ms. A step that gets
+        // preempted only makes the estimate larger, so the count never goes up.
+        FrameBudget budget(1.0);
+        StepCost cost;
+        for (int frame = 0; frame < 20; frame++) {
+            budget.beginFrame();
+            int steps = 0;
+            while (budget.beginStep(cost)) {
+                spin(0.3);
+                budget.endStep();
+                steps++;
+            }
+            CHECK(steps >= 1 && steps <= 3);
+        }
+    });
+
+    registerTest("FrameBudget takes one over-budget step a frame", [] {
+        FrameBudget budget(1.0);
+        StepCost cost;
+        for (int frame = 0; frame < 3; frame++) {
+            budget.beginFrame();
+            int steps = 0;
+            while (budget.beginStep(cost)) {
+                spin(1.5);
+                budget.endStep();
+                steps++;
+            }
+            CHECK(steps == 1);
+        }
+    });
+}
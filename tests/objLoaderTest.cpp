@@ -0,0 +1,84 @@
+#include "test.h"
+#include <fmt/format.h>
+#include <utilities/objLoader.h>
+
+// A grid of quads with positions, texture coordinates and normals. The first object's
+// vertices are all defined before its faces, so that relative indices in its last faces
+// point far back; the second object defines each row just before the faces that use it.
+// With relative set, every face refers to its corners with negative indices.
+static std::string gridOBJ(int size, bool relative) {
+    std::string text;
+    int positions = 0;
+    auto reference = [&](int index) {
+        int value = relative ? index - positions - 1 : index;
+        return fmt::format(" {}/{}/{}", value, value, value);
+    };
+    auto vertex = [&](int x, int y, float height) {
+        text += fmt::format("v {} {} {}\nvt {} {}\nvn 0 1 {}\n", x, height, y, x / float(size), y / float(size),
+                            height);
+        positions++;
+    };
+    auto quad = [&](int first, int rowLength) {
+        text += "f" + reference(first) + reference(first + 1) + reference(first + rowLength + 1) +
+                reference(first + rowLength) + "\n";
+    };
+
+    text += "o first\n";
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            vertex(x, y, 0.5f);
+        }
+    }
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            quad(1 + y * (size + 1) + x, size + 1);
+        }
+    }
+
+    text += "o second\n";
+    int start = positions + 1;
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            vertex(x, y, -0.25f);
+        }
+        for (int x = 0; y > 0 && x < size; x++) {
+            quad(start + (y - 1) * (size + 1) + x, size + 1);
+        }
+    }
+    return text;
+}
+
+static bool sameObjects(const std::vector<OBJObject> &a, const std::vector<OBJObject> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].name != b[i].name || a[i].mesh.vertices != b[i].mesh.vertices ||
+            a[i].mesh.textureCoordinates != b[i].mesh.textureCoordinates || a[i].mesh.normals != b[i].mesh.normals ||
+            a[i].mesh.indices != b[i].mesh.indices) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TESTS {
+    registerTest("parseOBJ/relative indices", [] {
+        std::string absolute = gridOBJ(20, false);
+        std::string relative = gridOBJ(20, true);
+        std::vector<OBJObject> expected = parseOBJ(absolute.data(), absolute.size(), 1);
+        CHECK(expected.size() == 2);
+        CHECK(expected.size() == 2 && expected[0].mesh.indices.size() == 20 * 20 * 6);
+        CHECK(sameObjects(parseOBJ(relative.data(), relative.size(), 1), expected));
+    });
+
+    registerTest("parseOBJ/chunks", [] {
+        for (bool relative : {false, true}) {
+            std::string text = gridOBJ(20, relative);
+            std::vector<OBJObject> oneChunk = parseOBJ(text.data(), text.size(), 1);
+            for (size_t chunks : {2, 3, 7, 16, 61}) {
+                CHECK(sameObjects(parseOBJ(text.data(), text.size(), chunks), oneChunk));
+            }
+        }
+    });
+}
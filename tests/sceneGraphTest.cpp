@@ -0,0 +1,117 @@
+#include "test.h"
+#include <sceneGraph.hpp>
+
+static const uint32_t maxGeneration = (1u << (32 - SCENE_NODE_INDEX_BITS)) - 1;
+
+TESTS {
+    registerTest("SceneNodeHandle of a destroyed node resolves to nullptr", [] {
+        SceneNode *node = createSceneNode();
+        SceneNodeHandle handle = node->handle;
+        CHECK(handle != SceneNodeHandle());
+        CHECK(resolveSceneNode(handle) == node);
+        destroySceneNode(node);
+        CHECK(resolveSceneNode(handle) == nullptr);
+        CHECK(resolveSceneNode(SceneNodeHandle()) == nullptr);
+    });
+
+    registerTest("SceneNodeHandle of a reused slot has a new generation", [] {
+        SceneNode *node = createSceneNode();
+        SceneNodeHandle old = node->handle;
+        destroySceneNode(node);
+
+        // Destroyed slots are reused last in, first out
+        SceneNode *reused = createSceneNode();
+        CHECK(reused == node);
+        CHECK(reused->handle.index() == old.index());
+        CHECK(reused->handle.generation() != old.generation());
+        CHECK(resolveSceneNode(old) == nullptr);
+        CHECK(resolveSceneNode(reused->handle) == reused);
+        destroySceneNode(reused);
+    });
+
+    registerTest("SceneNodeHandle generation wraps around and skips 0", [] {
+        SceneNode *node = createSceneNode();
+        SceneNodeHandle first = node->handle;
+        bool wrapped = false;
+        for (uint32_t i = 0; i < maxGeneration; i++) {
+            uint32_t generation = node->handle.generation();
+            destroySceneNode(node);
+            node = createSceneNode();
+            CHECK(node->handle.index() == first.index());
+            CHECK(node->handle.generation() != 0);
+            CHECK(node->handle != SceneNodeHandle());
+            if (generation == maxGeneration) {
+                CHECK(node->handle.generation() == 1);
+                wrapped = true;
+            }
+        }
+        CHECK(wrapped);
+        // After maxGeneration reuses the slot is back at its first generation
+        CHECK(node->handle == first);
+        destroySceneNode(node);
+    });
+
+    registerTest("destroySceneNode invalidates every descendant", [] {
+        size_t liveBefore = liveSceneNodeCount();
+        SceneNode *root = createSceneNode();
+        SceneNode *child = createSceneNode();
+        SceneNode *sibling = createSceneNode();
+        SceneNode *grandchild = createSceneNode();
+        addChild(root, child);
+        addChild(root, sibling);
+        addChild(child, grandchild);
+        SceneNodeHandle handles[] = {root->handle, child->handle, sibling->handle, grandchild->handle};
+
+        destroySceneNode(root);
+        for (SceneNodeHandle handle : handles) {
+            CHECK(resolveSceneNode(handle) == nullptr);
+        }
+        CHECK(liveSceneNodeCount() == liveBefore);
+    });
+
+    registerTest("removeFromParent keeps the siblings linked", [] {
+        SceneNode *root = createSceneNode();
+        SceneNode *children[4];
+        for (SceneNode *&child : children) {
+            child = createSceneNode();
+            addChild(root, child);
+        }
+
+        removeFromParent(children[1]);
+        CHECK(children[0]->nextSibling == children[2]);
+        CHECK(children[2]->previousSibling == children[0]);
+        removeFromParent(children[0]);
+        CHECK(root->firstChild == children[2]);
+        CHECK(children[2]->previousSibling == nullptr);
+        removeFromParent(children[3]);
+        CHECK(root->lastChild == children[2]);
+        CHECK(children[2]->nextSibling == nullptr);
+        CHECK(totalChildren(root) == 1);
+
+        addChild(root, children[1]);
+        CHECK(children[2]->nextSibling == children[1]);
+        CHECK(children[1]->previousSibling == children[2]);
+        CHECK(root->lastChild == children[1]);
+
+        destroySceneNode(root);
+        destroySceneNode(children[0]);
+        destroySceneNode(children[3]);
+    });
+
+    registerTest("createSceneNode keeps the capacity of a reused slot", [] {
+        SceneNode *node = createSceneNode();
+        node->text = "a label too long for the small string buffer";
+        node->lods.resize(4);
+        size_t textCapacity = node->text.capacity();
+        size_t lodCapacity = node->lods.capacity();
+        destroySceneNode(node);
+
+        SceneNode *reused = createSceneNode();
+        CHECK(reused == node);
+        CHECK(reused->text.empty());
+        CHECK(reused->lods.empty());
+        CHECK(reused->text.capacity() == textCapacity);
+        CHECK(reused->lods.capacity() == lodCapacity);
+        destroySceneNode(reused);
+    });
+}
@@ -0,0 +1,48 @@
+#include "test.h"
+#include <cstdio>
+#include <vector>
+
+struct RegisteredTest {
+    std::string name;
+    TestBody body;
+};
+
+// Function local, as the tests are registered during static initialisation
+static std::vector<RegisteredTest> &registeredTests() {
+    static std::vector<RegisteredTest> tests;
+    return tests;
+}
+
+static int failedChecks = 0;
+
+void registerTest(const std::string &name, TestBody body) {
+    registeredTests().push_back({name, std::move(body)});
+}
+
+void checkCondition(bool condition, const char *text, const char *file, int line) {
+    if (!condition) {
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, text);
+        failedChecks++;
+    }
+}
+
+// Runs the tests whose name contains the first argument, or all of them
+int main(int argc, const char *argv[]) {
+    std::string filter = argc > 1 ? argv[1] : "";
+    int failedTests = 0;
+    for (const RegisteredTest &test : registeredTests()) {
+        if (test.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        int failedBefore = failedChecks;
+        test.body();
+        bool passed = failedChecks == failedBefore;
+        fprintf(stderr, "%-48s %s\n", test.name.c_str(), passed ? "passed" : "FAILED");
+        failedTests += passed ? 0 : 1;
+    }
+    if (failedTests > 0) {
+        fprintf(stderr, "%d tests failed\n", failedTests);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+// Runs the checks of one test
+using TestBody = std::function<void()>;
+
+void registerTest(const std::string &name, TestBody body);
+
+// Registers tests from a file's static initialisers:
+//     TESTS { registerTest("name", [] { CHECK(...); }); }
+#define TEST_CONCATENATE_(a, b) a##b
+#define TEST_CONCATENATE(a, b) TEST_CONCATENATE_(a, b)
+#define TESTS                                                                                                          \
+    static void TEST_CONCATENATE(registerTests, __LINE__)();                                                           \
+    static const bool TEST_CONCATENATE(testsRegistered, __LINE__) =                                                   \
+        (TEST_CONCATENATE(registerTests, __LINE__)(), true);                                                           \
+    static void TEST_CONCATENATE(registerTests, __LINE__)()
+
+// Fails the running test if condition is false, and carries on with the rest of its checks
+#define CHECK(condition) checkCondition((condition), #condition, __FILE__, __LINE__)
+
+void checkCondition(bool condition, const char *text, const char *file, int line);